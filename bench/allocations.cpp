@@ -0,0 +1,35 @@
+#include "bench.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Counts every heap allocation in the bench binary, so scenarios can check
+// a code path allocates nothing per frame
+
+namespace
+{
+    std::atomic<unsigned long long> allocations{0};
+}
+
+unsigned long long benchAllocations()
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
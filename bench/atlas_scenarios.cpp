@@ -0,0 +1,198 @@
+#include "bench.hpp"
+#include "../wrappers/batch_renderer.hpp"
+#include "../wrappers/gl_state.hpp"
+#include "../wrappers/shader.hpp"
+#include "../wrappers/texture_atlas.hpp"
+#include <glad/glad.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace
+{
+    // Random sizes between 8 and 64 pixels, like icons and glyph-ish sprites
+    struct TestImage
+    {
+        int width;
+        int height;
+        std::vector<unsigned char> pixels;
+    };
+
+    std::vector<TestImage> makeImages(int count, int minSize, int maxSize)
+    {
+        std::vector<TestImage> images(count);
+        unsigned state = 42;
+        for (TestImage &image : images)
+        {
+            state = state * 1664525u + 1013904223u;
+            image.width = minSize + (state >> 8) % (maxSize - minSize + 1);
+            state = state * 1664525u + 1013904223u;
+            image.height = minSize + (state >> 8) % (maxSize - minSize + 1);
+            image.pixels.assign((size_t) image.width * image.height * 4, (unsigned char) (state >> 24));
+        }
+        return images;
+    }
+
+    // 5k images into 2048x2048 pages, in arrival order (what a runtime
+    // atlas sees) or tallest first (what atlasbake does)
+    class AtlasPackScenario : public BenchScenario
+    {
+        bool _sorted;
+        std::vector<TestImage> _images;
+        float _occupancy = 0.0f;
+        size_t _pages = 0;
+
+        public:
+            explicit AtlasPackScenario(bool sorted) : _sorted(sorted) {}
+
+            int frames(int requested) const override { return std::min(requested, 30); }
+            int warmupFrames(int requested) const override { return std::min(requested, 3); }
+
+            void setup() override
+            {
+                _images = makeImages(5000, 8, 64);
+                if (_sorted)
+                    std::stable_sort(_images.begin(), _images.end(), [] (const TestImage &a, const TestImage &b) {
+                        return a.height > b.height;
+                    });
+            }
+
+            void frame() override
+            {
+                TextureAtlas atlas { 2048, 1 };
+                for (const TestImage &image : _images)
+                    atlas.add("", image.pixels.data(), image.width, image.height, 4);
+                _occupancy = atlas.occupancy();
+                _pages = atlas.pageCount();
+            }
+
+            void metrics(std::vector<BenchMetric> &out) const override
+            {
+                out.push_back({ "occupancy", _occupancy * 100.0, "%", false });
+                out.push_back({ "pages", (double) _pages, "pages" });
+            }
+    };
+
+    // A baked atlas loads back the same, and any bad file leaves the atlas
+    // empty rather than half replaced
+    void checkAtlasLoad(const TextureAtlas &source, int pageSize)
+    {
+        std::string prefix = benchTempDirectory() + "/sprites";
+        benchCheck(source.write(prefix), "atlas writes");
+
+        TextureAtlas loaded { 64, 1 };
+        bool same = loaded.load(prefix) && loaded.pageCount() == source.pageCount()
+            && loaded.regionCount() == source.regionCount();
+        for (size_t i = 0; same && i < source.regionCount(); i++)
+            same = loaded.region((int) i).page == source.region((int) i).page
+                && loaded.region((int) i).uv[2] == source.region((int) i).uv[2];
+        benchCheck(same, "atlas loads back what was written");
+
+        std::filesystem::copy_file(prefix + "_0.txb", prefix + "_bad_0.txb",
+                                   std::filesystem::copy_options::overwrite_existing);
+        std::ofstream(prefix + "_bad.atlas") << "atlas " << pageSize << " 1\n"
+                                             << "0 0 0 16 16 fine\n1 0 0 16 16 page_out_of_range\n";
+        benchCheck(!loaded.load(prefix + "_bad") && loaded.pageCount() == 0 && loaded.regionCount() == 0,
+                   "atlas with an out of range page index loads empty");
+
+        benchCheck(loaded.load(prefix), "atlas loads again after a bad file");
+        std::filesystem::remove(prefix + "_0.txb");
+        benchCheck(!loaded.load(prefix) && loaded.pageCount() == 0 && loaded.regionCount() == 0,
+                   "atlas with a missing page loads empty");
+    }
+
+    // 10k sprites showing 256 different small images, each its own texture
+    // or all regions of one atlas page, drawn through BatchRenderer
+    class AtlasSpriteScenario : public BenchScenario
+    {
+        static const int imageCount = 256;
+        static const int spriteCount = 10000;
+        static const int atlasPageSize = 512;
+
+        bool _atlas;
+        Shader* _shader = nullptr;
+        BatchRenderer* _batch = nullptr;
+        TextureAtlas* _textureAtlas = nullptr;
+        std::vector<GLuint> _textures;
+        unsigned _drawCalls = 0;
+
+        public:
+            explicit AtlasSpriteScenario(bool atlas) : _atlas(atlas) {}
+
+            ~AtlasSpriteScenario()
+            {
+                if (!_textures.empty())
+                    GLState::deleteTextures(_textures.size(), _textures.data());
+                delete _textureAtlas;
+                delete _batch;
+                delete _shader;
+            }
+
+            void setup() override
+            {
+                _shader = new Shader("shaders/sprite.vs", "shaders/sprite.fs");
+                _shader->use();
+                _shader->setUniform("sprite"_u, 0);
+                _batch = new BatchRenderer();
+
+                std::vector<TestImage> images = makeImages(imageCount, 16, 16);
+                if (_atlas)
+                {
+                    _textureAtlas = new TextureAtlas(atlasPageSize, 1);
+                    for (const TestImage &image : images)
+                        _textureAtlas->add("", image.pixels.data(), image.width, image.height, 4);
+                    _textureAtlas->upload();
+                    checkAtlasLoad(*_textureAtlas, atlasPageSize);
+                    return;
+                }
+
+                _textures.resize(imageCount);
+                glGenTextures(imageCount, _textures.data());
+                for (int i = 0; i < imageCount; i++)
+                {
+                    GLState::bindTexture(GL_TEXTURE_2D, _textures[i]);
+                    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, images[i].width, images[i].height, 0, GL_RGBA,
+                                 GL_UNSIGNED_BYTE, images[i].pixels.data());
+                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                }
+            }
+
+            void frame() override
+            {
+                glClear(GL_COLOR_BUFFER_BIT);
+                _batch->begin();
+
+                const float color[3] = { 1.0f, 1.0f, 1.0f };
+                const int side = 100;
+                const float step = 2.0f / side;
+                for (int i = 0; i < spriteCount; i++)
+                {
+                    int image = (i * 37) % imageCount;
+                    float x = -1.0f + (i % side) * step;
+                    float y = -1.0f + (i / side) * step;
+                    if (_atlas)
+                    {
+                        const AtlasRegion &region = _textureAtlas->region(image);
+                        _batch->sprite(*_shader, _textureAtlas->pageTexture(region.page), x, y, step, step, color,
+                                       0.0f, region.uv);
+                    }
+                    else
+                        _batch->sprite(*_shader, _textures[image], x, y, step, step, color);
+                }
+
+                _batch->end();
+                _drawCalls = _batch->stats().drawCalls;
+            }
+
+            void metrics(std::vector<BenchMetric> &out) const override
+            {
+                out.push_back({ "draw_calls", (double) _drawCalls, "draws" });
+            }
+    };
+
+    bool registered = registerBench("atlas_pack_online", benchFactory<AtlasPackScenario>(false))
+        && registerBench("atlas_pack_sorted", benchFactory<AtlasPackScenario>(true))
+        && registerBench("sprites_separate_textures", benchFactory<AtlasSpriteScenario>(false))
+        && registerBench("sprites_atlas", benchFactory<AtlasSpriteScenario>(true));
+}
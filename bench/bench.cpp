@@ -0,0 +1,326 @@
+#include "bench.hpp"
+#include "../wrappers/app_context.hpp"
+#include "../wrappers/program_cache.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+// Runs every registered scenario headless and writes the results.
+//
+//     bench.exe [--frames N] [--warmup N] [--filter text] [--list]
+//               [--csv out.csv] [--json out.json]
+//               [--baseline old.csv] [--threshold percent]
+//
+// With a baseline (the CSV of an earlier run), every gated metric that got
+// worse by more than the threshold is reported and the exit code is 1.
+// So is any failed benchCheck().
+
+namespace
+{
+    struct Registration
+    {
+        std::string name;
+        BenchFactory factory;
+    };
+
+    // Scenario running now, and benchCheck() failures so far
+    std::string s_scenario;
+    unsigned s_failedChecks = 0;
+
+    // Function-local so registrations from other files' statics are safe
+    std::vector<Registration>& registry()
+    {
+        static std::vector<Registration> scenarios;
+        return scenarios;
+    }
+
+    struct Result
+    {
+        std::string name;
+        int frames;
+        // Gated metrics are the ones compared against a baseline; means and
+        // tails of frame times are too noisy for that
+        std::vector<std::pair<BenchMetric, bool>> metrics;
+    };
+
+    double percentile(const std::vector<double> &sorted, double p)
+    {
+        return sorted[std::min(sorted.size() - 1, (size_t) (p * sorted.size()))];
+    }
+
+    void addFrameMetrics(Result &result, const char* prefix, std::vector<double> times)
+    {
+        std::sort(times.begin(), times.end());
+        double total = 0.0;
+        for (double ms : times)
+            total += ms;
+
+        std::string p = prefix;
+        result.metrics.push_back({ { p + "_p50_ms", percentile(times, 0.50), "ms" }, true });
+        result.metrics.push_back({ { p + "_mean_ms", total / times.size(), "ms" }, false });
+        result.metrics.push_back({ { p + "_p95_ms", percentile(times, 0.95), "ms" }, false });
+        result.metrics.push_back({ { p + "_p99_ms", percentile(times, 0.99), "ms" }, false });
+    }
+
+    bool runScenario(const Registration &registration, int requestedFrames, int requestedWarmup, Result &result,
+                     std::string &renderer)
+    {
+        s_scenario = registration.name;
+        std::unique_ptr<BenchScenario> scenario = registration.factory();
+        int frames = std::max(1, scenario->frames(requestedFrames));
+        int warmup = std::max(0, std::min(requestedWarmup, scenario->warmupFrames(requestedWarmup)));
+
+        // The context only knows how many frames to run from its arguments
+        std::string frameCount = std::to_string(warmup + frames);
+        char* argv[] = { (char*) "bench", (char*) "--headless", (char*) frameCount.c_str() };
+        AppContext app { 800, 600, registration.name.c_str(), 3, argv };
+        if (!app.valid())
+            return false;
+
+        if (renderer.empty())
+            renderer = (const char*) glGetString(GL_RENDERER);
+
+        // Every scenario starts from an empty program cache, whatever
+        // earlier runs or scenarios left behind
+        ProgramCache::setDirectory(benchTempDirectory() + "/programs_" + registration.name);
+
+        scenario->setup();
+        while (!app.shouldClose())
+        {
+            scenario->frame();
+            app.endFrame();
+        }
+
+        std::vector<double> cpu;
+        std::vector<double> wall;
+        const std::vector<AppContext::FrameTime> &times = app.frameTimes();
+        for (size_t i = warmup; i < times.size(); i++)
+        {
+            cpu.push_back(times[i].cpuMs);
+            wall.push_back(times[i].wallMs);
+        }
+
+        result.name = registration.name;
+        result.frames = frames;
+        addFrameMetrics(result, "cpu", cpu);
+        addFrameMetrics(result, "wall", wall);
+
+        std::vector<BenchMetric> extra;
+        scenario->metrics(extra);
+        for (const BenchMetric &metric : extra)
+            result.metrics.push_back({ metric, true });
+
+        // GL objects go while the context is still current
+        scenario.reset();
+        return true;
+    }
+
+    void writeCsv(const char* path, const std::vector<Result> &results)
+    {
+        std::ofstream file(path);
+        file << "scenario,metric,value,unit,better\n";
+        for (const Result &result : results)
+        {
+            for (const auto &pair : result.metrics)
+            {
+                const BenchMetric &metric = pair.first;
+                file << result.name << "," << metric.name << "," << metric.value << "," << metric.unit << ","
+                     << (metric.lowerIsBetter ? "lower" : "higher") << "\n";
+            }
+        }
+    }
+
+    void writeJson(const char* path, const std::vector<Result> &results, const std::string &renderer,
+                   int warmup)
+    {
+        std::ofstream file(path);
+        file << "{\n  \"renderer\": \"" << renderer << "\",\n  \"warmup\": " << warmup << ",\n  \"scenarios\": [";
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const Result &result = results[i];
+            file << (i ? "," : "") << "\n    { \"name\": \"" << result.name << "\", \"frames\": " << result.frames
+                 << ", \"metrics\": {";
+            for (size_t j = 0; j < result.metrics.size(); j++)
+            {
+                const BenchMetric &metric = result.metrics[j].first;
+                file << (j ? ", " : "") << "\"" << metric.name << "\": " << metric.value;
+            }
+            file << "} }";
+        }
+        file << "\n  ]\n}\n";
+    }
+
+    // scenario/metric -> value, from a CSV written by an earlier run
+    bool readBaseline(const char* path, std::map<std::string, double> &values)
+    {
+        std::ifstream file(path);
+        if (!file)
+            return false;
+
+        std::string line;
+        std::getline(file, line); // header
+        while (std::getline(file, line))
+        {
+            std::istringstream fields(line);
+            std::string scenario, metric, value;
+            if (std::getline(fields, scenario, ',') && std::getline(fields, metric, ',')
+                && std::getline(fields, value, ','))
+                values[scenario + "/" + metric] = std::atof(value.c_str());
+        }
+        return true;
+    }
+
+    int compareBaseline(const std::vector<Result> &results, const std::map<std::string, double> &baseline,
+                        double threshold)
+    {
+        int regressions = 0;
+        int compared = 0;
+        for (const Result &result : results)
+        {
+            for (const auto &pair : result.metrics)
+            {
+                const BenchMetric &metric = pair.first;
+                auto it = baseline.find(result.name + "/" + metric.name);
+                if (!pair.second || it == baseline.end() || it->second <= 0.0)
+                    continue;
+
+                compared++;
+                double change = (metric.value - it->second) / it->second * 100.0;
+                bool worse = metric.lowerIsBetter ? change > threshold : -change > threshold;
+                if (worse)
+                {
+                    std::cout << "REGRESSION " << result.name << " " << metric.name << ": " << it->second
+                              << " -> " << metric.value << " " << metric.unit << " (" << (change > 0 ? "+" : "")
+                              << change << "%)" << std::endl;
+                    regressions++;
+                }
+            }
+        }
+
+        std::cout << "Baseline: " << compared << " metric(s) compared, " << regressions
+                  << " regression(s) over " << threshold << "%" << std::endl;
+        return regressions;
+    }
+}
+
+bool registerBench(const char* name, BenchFactory factory)
+{
+    registry().push_back({ name, factory });
+    return true;
+}
+
+std::string benchTempDirectory()
+{
+    return (std::filesystem::temp_directory_path() / "learngl-bench").string();
+}
+
+void benchCheck(bool condition, const char* what)
+{
+    if (condition)
+        return;
+    std::cout << "ERROR::BENCH::CHECK_FAILED " << s_scenario << ": " << what << std::endl;
+    s_failedChecks++;
+}
+
+int main(int argc, char** argv)
+{
+    int frames = 200;
+    int warmup = 20;
+    double threshold = 10.0;
+    const char* filter = nullptr;
+    const char* csvPath = nullptr;
+    const char* jsonPath = nullptr;
+    const char* baselinePath = nullptr;
+    bool list = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--frames") == 0 && hasValue)
+            frames = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--warmup") == 0 && hasValue)
+            warmup = std::max(0, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--threshold") == 0 && hasValue)
+            threshold = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--filter") == 0 && hasValue)
+            filter = argv[++i];
+        else if (std::strcmp(argv[i], "--csv") == 0 && hasValue)
+            csvPath = argv[++i];
+        else if (std::strcmp(argv[i], "--json") == 0 && hasValue)
+            jsonPath = argv[++i];
+        else if (std::strcmp(argv[i], "--baseline") == 0 && hasValue)
+            baselinePath = argv[++i];
+        else if (std::strcmp(argv[i], "--list") == 0)
+            list = true;
+        else
+        {
+            std::cout << "ERROR::BENCH::UNKNOWN_ARGUMENT " << argv[i] << std::endl;
+            return 2;
+        }
+    }
+
+    if (list)
+    {
+        for (const Registration &registration : registry())
+            std::cout << registration.name << "\n";
+        return 0;
+    }
+
+    std::error_code ec;
+    std::filesystem::remove_all(benchTempDirectory(), ec);
+    std::filesystem::create_directories(benchTempDirectory(), ec);
+
+    std::vector<Result> results;
+    std::string renderer;
+    for (const Registration &registration : registry())
+    {
+        if (filter && registration.name.find(filter) == std::string::npos)
+            continue;
+
+        Result result;
+        if (!runScenario(registration, frames, warmup, result, renderer))
+        {
+            std::cout << "ERROR::BENCH::CONTEXT_FAILED " << registration.name << std::endl;
+            return 2;
+        }
+        results.push_back(result);
+    }
+
+    std::cout << "\nRenderer: " << renderer << "\n";
+    for (const Result &result : results)
+    {
+        std::cout << result.name << " (" << result.frames << " frames)\n";
+        for (const auto &pair : result.metrics)
+            std::cout << "    " << pair.first.name << " = " << pair.first.value << " " << pair.first.unit << "\n";
+    }
+    std::cout << std::flush;
+
+    if (csvPath)
+        writeCsv(csvPath, results);
+    if (jsonPath)
+        writeJson(jsonPath, results, renderer, warmup);
+
+    if (baselinePath)
+    {
+        std::map<std::string, double> baseline;
+        if (!readBaseline(baselinePath, baseline))
+        {
+            std::cout << "ERROR::BENCH::BASELINE_NOT_READ " << baselinePath << std::endl;
+            return 2;
+        }
+        if (compareBaseline(results, baseline, threshold) > 0)
+            return 1;
+    }
+
+    if (s_failedChecks > 0)
+    {
+        std::cout << s_failedChecks << " failed check(s)" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,62 @@
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// A number a scenario reports next to its frame times
+struct BenchMetric
+{
+    std::string name;
+    double value;
+    std::string unit;
+    bool lowerIsBetter = true;
+};
+
+// One benchmark. Each scenario gets its own headless AppContext: setup()
+// runs once with it current, then frame() runs for the warm-up and timed
+// frames, every one followed by glFinish. CPU-only scenarios just do one
+// iteration of their work per frame.
+class BenchScenario
+{
+    public:
+        virtual ~BenchScenario() {}
+
+        virtual void setup() {}
+        virtual void frame() = 0;
+
+        // Timed and warm-up frames to run, slow scenarios can ask for fewer
+        virtual int frames(int requested) const { return requested; }
+        virtual int warmupFrames(int requested) const { return requested; }
+
+        // Extra numbers gathered over the run (throughput, allocations, ...)
+        virtual void metrics(std::vector<BenchMetric> & /*out*/) const {}
+};
+
+typedef std::function<std::unique_ptr<BenchScenario>()> BenchFactory;
+
+// Adds a scenario under name, returns true so it can initialize a static:
+//
+//     static bool registered = registerBench("clear", benchFactory<ClearScenario>());
+bool registerBench(const char* name, BenchFactory factory);
+
+template<class T, class... Args>
+BenchFactory benchFactory(Args... args)
+{
+    return [=] () { return std::unique_ptr<BenchScenario>(new T(args...)); };
+}
+
+// Heap allocations made so far by the process (operator new is replaced
+// in the bench binary to count them)
+unsigned long long benchAllocations();
+
+// Scratch directory for files scenarios generate, emptied at startup
+std::string benchTempDirectory();
+
+// For scenarios that also check the behavior they time: a false condition
+// is reported with what, and the bench exits with 1 after the run
+void benchCheck(bool condition, const char* what);
+
+#endif // BENCH_H_
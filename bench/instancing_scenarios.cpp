@@ -0,0 +1,155 @@
+#include "bench.hpp"
+#include "../wrappers/instanced_mesh.hpp"
+#include "../wrappers/gl_state.hpp"
+#include "../wrappers/shader.hpp"
+#include <glad/glad.h>
+#include <algorithm>
+
+// Many copies of the textures sample's quad: one uniform update and draw
+// per copy, or a single instanced draw
+
+namespace
+{
+    const int instanceCount = 100000;
+
+    class QuadCopiesScenario : public BenchScenario
+    {
+        protected:
+        Shader* _shader = nullptr;
+        GLuint _texture = 0;
+        GLuint _vao = 0;
+        GLuint _vbo = 0;
+        GLuint _ebo = 0;
+        std::vector<InstanceData> _instances;
+        unsigned _drawCalls = 0;
+
+        void setupQuad(const char* vertexShader)
+        {
+            _shader = new Shader(vertexShader, "shaders/sprite.fs");
+            _shader->use();
+            _shader->setUniform("sprite"_u, 0);
+
+            float vertices[] = {
+                0.5f,  0.5f, 0.0f,   1.0f, 1.0f, 1.0f,   1.0f, 1.0f,
+                0.5f, -0.5f, 0.0f,   1.0f, 1.0f, 1.0f,   1.0f, 0.0f,
+                -0.5f, -0.5f, 0.0f,   1.0f, 1.0f, 1.0f,   0.0f, 0.0f,
+                -0.5f,  0.5f, 0.0f,   1.0f, 1.0f, 1.0f,   0.0f, 1.0f
+            };
+            unsigned int indices[] = { 0, 1, 3, 1, 2, 3 };
+
+            glGenVertexArrays(1, &_vao);
+            glGenBuffers(1, &_vbo);
+            glGenBuffers(1, &_ebo);
+            GLState::bindVertexArray(_vao);
+            GLState::bindBuffer(GL_ARRAY_BUFFER, _vbo);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+            GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ebo);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+            glEnableVertexAttribArray(2);
+
+            unsigned char white[4] = { 255, 255, 255, 255 };
+            glGenTextures(1, &_texture);
+            GLState::bindTexture(GL_TEXTURE_2D, _texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+            // A jittered grid covering the whole framebuffer
+            int side = 317; // ceil(sqrt(instanceCount))
+            unsigned state = 1;
+            for (int i = 0; i < instanceCount; i++)
+            {
+                state = state * 1664525u + 1013904223u;
+                float jitter = (state >> 16) / 65536.0f;
+                float x = -1.0f + 2.0f * ((i % side) + jitter * 0.5f) / side;
+                float y = -1.0f + 2.0f * ((i / side) + jitter * 0.5f) / side;
+                _instances.push_back({ { x, y, 0.0f }, 1.5f / side, { jitter, 1.0f - jitter, 0.5f }, 0 });
+            }
+        }
+
+        public:
+            ~QuadCopiesScenario()
+            {
+                GLState::deleteVertexArrays(1, &_vao);
+                GLState::deleteBuffers(1, &_vbo);
+                GLState::deleteBuffers(1, &_ebo);
+                GLState::deleteTextures(1, &_texture);
+                delete _shader;
+            }
+
+            void metrics(std::vector<BenchMetric> &out) const override
+            {
+                out.push_back({ "instances", (double) _instances.size(), "instances", false });
+                out.push_back({ "draw_calls", (double) _drawCalls, "draws" });
+            }
+    };
+
+    class NaiveCopiesScenario : public QuadCopiesScenario
+    {
+        UniformHandle _offsetScale;
+        UniformHandle _tint;
+
+        public:
+            // Seconds per frame on llvmpipe
+            int frames(int requested) const override { return std::min(requested, 5); }
+            int warmupFrames(int requested) const override { return std::min(requested, 1); }
+
+            void setup() override
+            {
+                setupQuad("shaders/quad_uniform.vs");
+                _offsetScale = _shader->uniform("offsetScale"_u);
+                _tint = _shader->uniform("tint"_u);
+            }
+
+            void frame() override
+            {
+                glClear(GL_COLOR_BUFFER_BIT);
+                _shader->use();
+                GLState::activeTexture(GL_TEXTURE0);
+                GLState::bindTexture(GL_TEXTURE_2D, _texture);
+                GLState::bindVertexArray(_vao);
+                for (const InstanceData &instance : _instances)
+                {
+                    glUniform4f(_offsetScale.location, instance.offset[0], instance.offset[1], instance.offset[2],
+                                instance.scale);
+                    glUniform3fv(_tint.location, 1, instance.color);
+                    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+                }
+                _drawCalls = _instances.size();
+            }
+    };
+
+    class InstancedCopiesScenario : public QuadCopiesScenario
+    {
+        InstancedMesh* _mesh = nullptr;
+
+        public:
+            ~InstancedCopiesScenario() { delete _mesh; }
+
+            void setup() override
+            {
+                setupQuad("shaders/quad_instanced.vs");
+                _mesh = new InstancedMesh(_vao, 6);
+            }
+
+            void frame() override
+            {
+                glClear(GL_COLOR_BUFFER_BIT);
+                _shader->use();
+                GLState::activeTexture(GL_TEXTURE0);
+                GLState::bindTexture(GL_TEXTURE_2D, _texture);
+
+                // Re-uploaded every frame, as it would be for moving objects
+                _mesh->setInstances(_instances.data(), _instances.size());
+                _mesh->draw();
+                _drawCalls = 1;
+            }
+    };
+
+    bool registered = registerBench("instances_naive", benchFactory<NaiveCopiesScenario>())
+        && registerBench("instances_instanced", benchFactory<InstancedCopiesScenario>());
+}
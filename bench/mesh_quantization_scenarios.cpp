@@ -0,0 +1,269 @@
+#include "bench.hpp"
+#include "../wrappers/batch_renderer.hpp"
+#include "../wrappers/gl_state.hpp"
+#include "../wrappers/mesh_quantizer.hpp"
+#include "../wrappers/shader.hpp"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+// A displaced, densely tessellated grid of BatchVertex (32 bytes a vertex),
+// drawn as is or quantized to 16 bytes with MeshQuantizer and loaded back
+// from a .qmesh, optionally by way of an .obj read like tools/meshbake
+// reads it. Besides frame time, reports how much memory quantizing saves
+// and how far the decoded mesh is from the original, and checks that the
+// .obj and .qmesh round trips lose nothing on the way.
+
+namespace
+{
+    const int gridSize = 256; // quads per side
+    const int drawsPerFrame = 8;
+
+    void buildGrid(std::vector<BatchVertex> &vertices, std::vector<GLuint> &indices)
+    {
+        for (int y = 0; y <= gridSize; y++)
+        {
+            for (int x = 0; x <= gridSize; x++)
+            {
+                float u = (float) x / gridSize, v = (float) y / gridSize;
+
+                // Texture coords tile past 0..1, as they do on real meshes
+                BatchVertex vertex;
+                vertex.position = { u * 2.0f - 1.0f, v * 2.0f - 1.0f,
+                                    0.1f * std::sin(u * 12.566371f) * std::cos(v * 12.566371f) };
+                vertex.color = { u, v, 1.0f - u };
+                vertex.texCoord = { u * 4.0f, v * 4.0f };
+                vertices.push_back(vertex);
+            }
+        }
+
+        for (int y = 0; y < gridSize; y++)
+        {
+            for (int x = 0; x < gridSize; x++)
+            {
+                GLuint corner = y * (gridSize + 1) + x;
+                GLuint above = corner + gridSize + 1;
+                indices.insert(indices.end(), { corner, corner + 1, above, corner + 1, above + 1, above });
+            }
+        }
+    }
+
+    // Triangles as written, so corner i of the file is index i of the grid.
+    // Enough digits that every float reads back exactly.
+    void writeObj(const std::string &path, const std::vector<BatchVertex> &vertices,
+                  const std::vector<GLuint> &indices)
+    {
+        std::ofstream file(path);
+        file << std::setprecision(9);
+        for (const BatchVertex &v : vertices)
+            file << "v " << v.position.x << " " << v.position.y << " " << v.position.z << " "
+                 << v.color.x << " " << v.color.y << " " << v.color.z << "\n";
+        for (const BatchVertex &v : vertices)
+            file << "vt " << v.texCoord.x << " " << v.texCoord.y << "\n";
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            file << "f";
+            for (size_t k = i; k < i + 3; k++)
+                file << " " << indices[k] + 1 << "/" << indices[k] + 1;
+            file << "\n";
+        }
+    }
+
+    bool loadsObj(const std::string &path, const char* text, std::vector<BatchVertex> &vertices,
+                  std::vector<GLuint> &indices)
+    {
+        std::ofstream(path) << text;
+        return MeshQuantizer::loadObj(path.c_str(), vertices, indices);
+    }
+
+    // The corners of an .obj face a grid never has: relative indices, fans,
+    // missing texture coords and indices that point nowhere
+    void checkObjFaces(const std::string &directory)
+    {
+        const std::string path = directory + "/faces.obj";
+        const char* square = "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\nvt 0 0\nvt 1 0\nvt 0 1\nvt 1 1\n";
+
+        std::vector<BatchVertex> vertices;
+        std::vector<GLuint> indices;
+        bool loaded = loadsObj(path, (std::string(square) + "f -4/-4 -3/-3 -1/-1 -2/-2\n").c_str(), vertices, indices);
+        benchCheck(loaded && vertices.size() == 4 && indices.size() == 6, ".obj quad split into a fan");
+        benchCheck(loaded && vertices.size() == 4 && vertices[2].position.x == 1.0f && vertices[2].position.y == 1.0f
+                       && vertices[2].texCoord.x == 1.0f && vertices[2].texCoord.y == 1.0f,
+                   ".obj negative indices count back from the end");
+
+        vertices.clear();
+        indices.clear();
+        loaded = loadsObj(path, (std::string(square) + "f 1//1 2//1 3//1\n").c_str(), vertices, indices);
+        benchCheck(loaded && vertices.size() == 3 && vertices[1].texCoord.x == 0.0f && vertices[1].texCoord.y == 0.0f,
+                   ".obj corner without a texture coord gets (0, 0)");
+
+        for (const char* face : { "f 5/1 1/1 2/1\n", "f 1/5 2/1 3/1\n", "f 1/-9 2/1 3/1\n", "f 1/0 2/1 3/1\n" })
+        {
+            vertices.clear();
+            indices.clear();
+            benchCheck(!loadsObj(path, (std::string(square) + face).c_str(), vertices, indices),
+                       (std::string(".obj rejects out of range ") + face).c_str());
+        }
+    }
+
+    class MeshQuantizationScenario : public BenchScenario
+    {
+        bool _quantized;
+        bool _fromObj;
+        Shader* _shader = nullptr;
+        GLuint _vao = 0;
+        GLuint _vbo = 0;
+        GLuint _ebo = 0;
+        GLsizei _indexCount = 0;
+        size_t _vertexBytes = 0;
+        QuantizationError _error;
+        MeshDecode _decode = {};
+
+        public:
+            MeshQuantizationScenario(bool quantized, bool fromObj = false)
+                : _quantized(quantized), _fromObj(fromObj) {}
+
+            ~MeshQuantizationScenario()
+            {
+                GLState::deleteVertexArrays(1, &_vao);
+                GLState::deleteBuffers(1, &_vbo);
+                GLState::deleteBuffers(1, &_ebo);
+                delete _shader;
+            }
+
+            void setup() override
+            {
+                std::vector<BatchVertex> vertices;
+                std::vector<GLuint> indices;
+                buildGrid(vertices, indices);
+                _indexCount = (GLsizei) indices.size();
+
+                glGenBuffers(1, &_vbo);
+                glGenBuffers(1, &_ebo);
+                if (!_quantized)
+                {
+                    _shader = new Shader("shaders/mesh_float.vs", "shaders/lit_vertex.fs");
+                    _vao = BatchVertexLayout::createVertexArray(_vbo, _ebo);
+                    _vertexBytes = vertices.size() * sizeof(BatchVertex);
+                    glBufferData(GL_ARRAY_BUFFER, _vertexBytes, vertices.data(), GL_STATIC_DRAW);
+                    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(),
+                                 GL_STATIC_DRAW);
+                    return;
+                }
+
+                // What meshbake does offline, then the runtime path: mmap and upload
+                std::string directory = benchTempDirectory();
+                std::string meshPath = directory + "/grid.qmesh";
+                std::string vertexPath = directory + "/mesh_quantized.vs";
+
+                if (_fromObj)
+                {
+                    std::string objPath = directory + "/grid.obj";
+                    writeObj(objPath, vertices, indices);
+
+                    std::vector<BatchVertex> parsed;
+                    std::vector<GLuint> parsedIndices;
+                    benchCheck(MeshQuantizer::loadObj(objPath.c_str(), parsed, parsedIndices), "grid .obj loads");
+                    benchCheck(parsed.size() == vertices.size() && parsedIndices.size() == indices.size(),
+                               "every .obj vertex and triangle read");
+
+                    bool same = parsedIndices.size() == indices.size();
+                    for (size_t i = 0; same && i < indices.size(); i++)
+                        same = std::memcmp(&parsed[parsedIndices[i]], &vertices[indices[i]], sizeof(BatchVertex)) == 0;
+                    benchCheck(same, ".obj corners read back exactly");
+
+                    checkObjFaces(directory);
+                    vertices.swap(parsed);
+                    indices.swap(parsedIndices);
+                }
+
+                QuantizedMesh mesh = MeshQuantizer::quantize(vertices.data(), vertices.size(),
+                                                             indices.data(), indices.size());
+                _error = MeshQuantizer::measure(vertices.data(), mesh);
+
+                // Rounding to the nearest 16-bit step is off by at most half
+                // a step per axis, and an 8-bit color by half of 1/255. The
+                // slack covers float rounding in the decode.
+                const float slack = 1e-6f;
+                const MeshDecode &ranges = mesh.decode;
+                float positionRange = std::max({ ranges.positionScale.x, ranges.positionScale.y, ranges.positionScale.z });
+                float texCoordRange = std::max(ranges.texCoordScale.x, ranges.texCoordScale.y);
+                benchCheck(_error.maxPosition <= positionRange / 65535.0f / 2.0f * std::sqrt(3.0f) + positionRange * slack,
+                           "position error within half a quantization step");
+                benchCheck(_error.maxTexCoord <= texCoordRange / 65535.0f / 2.0f + texCoordRange * slack,
+                           "texture coord error within half a quantization step");
+                benchCheck(_error.maxColor <= 0.5f / 255.0f + slack, "color error within half an 8-bit step");
+                QuantizedMeshFile::write(meshPath.c_str(), mesh);
+
+                std::ofstream(directory + "/mesh_decode.glsl") << MeshQuantizer::decodeGLSL();
+                std::ofstream(vertexPath)
+                    << "#version 330 core\n"
+                    << "#include \"mesh_decode.glsl\"\n"
+                    << "out vec4 color;\n"
+                    << "void main()\n{\n"
+                    << "    gl_Position = vec4(decodePosition(), 1.0);\n"
+                    << "    color = vec4(decodeColor() * (0.75 + 0.25 * sin(decodeTexCoord().x)), 1.0);\n}\n";
+                _shader = new Shader(vertexPath.c_str(), "shaders/lit_vertex.fs");
+
+                QuantizedMeshFile file(meshPath.c_str());
+                benchCheck(file.valid(), ".qmesh loads");
+                if (!file.valid())
+                    return;
+
+                const QuantizedMeshHeader &header = file.header();
+                benchCheck(header.vertexCount == mesh.vertices.size() && header.indexCount == mesh.indices.size(),
+                           ".qmesh header counts match the mesh");
+                benchCheck(std::memcmp(file.vertices(), mesh.vertices.data(),
+                                       mesh.vertices.size() * sizeof(QuantizedVertex)) == 0
+                               && std::memcmp(file.indices(), mesh.indices.data(),
+                                              mesh.indices.size() * sizeof(GLuint)) == 0,
+                           ".qmesh vertices and indices read back as written");
+                benchCheck(std::memcmp(&header.decode, &mesh.decode, sizeof(MeshDecode)) == 0,
+                           ".qmesh decode ranges read back as written");
+
+                // An index past the vertices is caught at load, not by the GPU
+                std::string badPath = directory + "/bad_index.qmesh";
+                QuantizedMesh bad = mesh;
+                bad.indices.back() = (GLuint) bad.vertices.size();
+                QuantizedMeshFile::write(badPath.c_str(), bad);
+                benchCheck(!QuantizedMeshFile(badPath.c_str()).valid(), ".qmesh with an index past its vertices rejected");
+                _decode = file.header().decode;
+                _vao = QuantizedVertexLayout::createVertexArray(_vbo, _ebo);
+                _vertexBytes = file.header().vertexCount * sizeof(QuantizedVertex);
+                file.upload();
+            }
+
+            void frame() override
+            {
+                glClear(GL_COLOR_BUFFER_BIT);
+                _shader->use();
+                if (_quantized)
+                    MeshQuantizer::setDecodeUniforms(*_shader, _decode);
+                GLState::bindVertexArray(_vao);
+                for (int i = 0; i < drawsPerFrame; i++)
+                    glDrawElements(GL_TRIANGLES, _indexCount, GL_UNSIGNED_INT, 0);
+            }
+
+            void metrics(std::vector<BenchMetric> &out) const override
+            {
+                size_t floatBytes = (gridSize + 1) * (gridSize + 1) * sizeof(BatchVertex);
+                out.push_back({ "bytes_per_vertex", (double) (_quantized ? sizeof(QuantizedVertex) : sizeof(BatchVertex)),
+                                "bytes" });
+                out.push_back({ "vertex_buffer_kb", _vertexBytes / 1024.0, "KB" });
+                out.push_back({ "memory_saved", 100.0 * (1.0 - (double) _vertexBytes / floatBytes), "%", false });
+                out.push_back({ "position_error_max", _error.maxPosition, "units" });
+                out.push_back({ "position_error_rms", _error.rmsPosition, "units" });
+                out.push_back({ "texcoord_error_max", _error.maxTexCoord, "units" });
+                out.push_back({ "color_error_max", _error.maxColor, "units" });
+            }
+    };
+
+    bool registered = registerBench("mesh_float", benchFactory<MeshQuantizationScenario>(false))
+        && registerBench("mesh_quantized", benchFactory<MeshQuantizationScenario>(true))
+        && registerBench("mesh_quantized_obj", benchFactory<MeshQuantizationScenario>(true, true));
+}
@@ -0,0 +1,175 @@
+#include "bench.hpp"
+#include "../wrappers/gl_state.hpp"
+#include "../wrappers/shader.hpp"
+#include "../wrappers/texture_array.hpp"
+#include <glad/glad.h>
+
+// The samples' render loops, minus input. Run from bench/, so shaders and
+// images come from the sample directories.
+
+namespace
+{
+    // hello_world: clear only, the floor for everything else
+    class ClearScenario : public BenchScenario
+    {
+        public:
+            void frame() override
+            {
+                glClearColor(0.0f, 0.1f, 0.8f, 1.0f);
+                glClear(GL_COLOR_BUFFER_BIT);
+            }
+    };
+
+    // shader_exercise1: one colored triangle. Also the base of ManyDrawsScenario.
+    class TriangleScenario : public BenchScenario
+    {
+        protected:
+        Shader* _shader = nullptr;
+        UniformHandle _offset;
+        GLuint _vao = 0;
+        GLuint _vbo = 0;
+
+        public:
+            ~TriangleScenario()
+            {
+                GLState::deleteVertexArrays(1, &_vao);
+                GLState::deleteBuffers(1, &_vbo);
+                delete _shader;
+            }
+
+            void setup() override
+            {
+                _shader = new Shader("../shaders/vertexShader1.glsl", "../shaders/fragShader1.glsl");
+                _offset = _shader->uniform("offset"_u);
+
+                float vertices[] = {
+                    0.5f, -0.5f, 0.0f,  1.0f, 0.0f, 0.0f,
+                    -0.5f, -0.5f, 0.0f,  0.0f, 1.0f, 0.0f,
+                    0.0f,  0.5f, 0.0f,  0.0f, 0.0f, 1.0f
+                };
+
+                glGenVertexArrays(1, &_vao);
+                glGenBuffers(1, &_vbo);
+                GLState::bindVertexArray(_vao);
+                GLState::bindBuffer(GL_ARRAY_BUFFER, _vbo);
+                glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+                glEnableVertexAttribArray(0);
+                glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+                glEnableVertexAttribArray(1);
+            }
+
+            void frame() override
+            {
+                glClear(GL_COLOR_BUFFER_BIT);
+                _shader->use();
+                _shader->setUniform(_offset, 0.0f);
+                GLState::bindVertexArray(_vao);
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+            }
+    };
+
+    // The triangle drawn over and over with a uniform change in between,
+    // which is where per-draw CPU overhead shows
+    class ManyDrawsScenario : public TriangleScenario
+    {
+        int _draws;
+
+        public:
+            explicit ManyDrawsScenario(int draws) : _draws(draws) {}
+
+            void frame() override
+            {
+                glClear(GL_COLOR_BUFFER_BIT);
+                _shader->use();
+                GLState::bindVertexArray(_vao);
+                for (int i = 0; i < _draws; i++)
+                {
+                    _shader->setUniform(_offset, (float) (i % 100) / 100.0f - 0.5f);
+                    glDrawArrays(GL_TRIANGLES, 0, 3);
+                }
+            }
+
+            void metrics(std::vector<BenchMetric> &out) const override
+            {
+                out.push_back({ "draws_per_frame", (double) _draws, "draws", false });
+            }
+    };
+
+    // textures: indexed quad with two layers of one texture array
+    class TexturedQuadScenario : public BenchScenario
+    {
+        Shader* _shader = nullptr;
+        std::vector<TextureArray> _arrays;
+        GLuint _vao = 0;
+        GLuint _vbo = 0;
+        GLuint _ebo = 0;
+
+        public:
+            ~TexturedQuadScenario()
+            {
+                GLState::deleteVertexArrays(1, &_vao);
+                GLState::deleteBuffers(1, &_vbo);
+                GLState::deleteBuffers(1, &_ebo);
+                for (const TextureArray &array : _arrays)
+                    GLState::deleteTextures(1, &array.texture);
+                delete _shader;
+            }
+
+            void setup() override
+            {
+                _shader = new Shader("../textures/vertexShader.glsl", "../textures/fragShader.glsl", { "FLIP_FACE" });
+
+                TextureArrayBuilder builder;
+                builder.add("../textures/container.jpg");
+                builder.add("../textures/awesomeface.png");
+                _arrays = builder.build();
+
+                float vertices[] = {
+                    0.5f,  0.5f, 0.0f,   1.0f, 0.0f, 0.0f,   1.0f, 1.0f,   0.0f, 1.0f,
+                    0.5f, -0.5f, 0.0f,   0.0f, 1.0f, 0.0f,   1.0f, 0.0f,   0.0f, 1.0f,
+                    -0.5f, -0.5f, 0.0f,   0.0f, 0.0f, 1.0f,   0.0f, 0.0f,   0.0f, 1.0f,
+                    -0.5f,  0.5f, 0.0f,   1.0f, 1.0f, 0.0f,   0.0f, 1.0f,   0.0f, 1.0f
+                };
+                unsigned int indices[] = { 0, 1, 3, 1, 2, 3 };
+
+                glGenVertexArrays(1, &_vao);
+                glGenBuffers(1, &_vbo);
+                glGenBuffers(1, &_ebo);
+                GLState::bindVertexArray(_vao);
+                GLState::bindBuffer(GL_ARRAY_BUFFER, _vbo);
+                glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+                GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ebo);
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 10 * sizeof(float), (void*)0);
+                glEnableVertexAttribArray(0);
+                glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 10 * sizeof(float), (void*)(3 * sizeof(float)));
+                glEnableVertexAttribArray(1);
+                glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 10 * sizeof(float), (void*)(6 * sizeof(float)));
+                glEnableVertexAttribArray(2);
+                glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 10 * sizeof(float), (void*)(8 * sizeof(float)));
+                glEnableVertexAttribArray(3);
+
+                _shader->use();
+                _shader->setUniform("textures"_u, 0);
+                _shader->setUniform("mult_amount"_u, 1);
+                _shader->setUniform("mix_amount"_u, 0.5f);
+
+                GLState::activeTexture(GL_TEXTURE0);
+                GLState::bindTexture(GL_TEXTURE_2D_ARRAY, _arrays[0].texture);
+            }
+
+            void frame() override
+            {
+                glClear(GL_COLOR_BUFFER_BIT);
+                _shader->use();
+                GLState::bindVertexArray(_vao);
+                glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            }
+    };
+
+    bool registered = registerBench("clear", benchFactory<ClearScenario>())
+        && registerBench("triangle", benchFactory<TriangleScenario>())
+        && registerBench("textured_quad", benchFactory<TexturedQuadScenario>())
+        && registerBench("many_draws", benchFactory<ManyDrawsScenario>(1000));
+}
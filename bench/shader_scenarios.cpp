@@ -0,0 +1,352 @@
+#include "bench.hpp"
+#include "../wrappers/shader.hpp"
+#include "../wrappers/shader_batch.hpp"
+#include "../wrappers/shader_preprocessor.hpp"
+#include "../wrappers/program_cache.hpp"
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+    const int uniformSetsPerFrame = 10000;
+
+    // Past the 15 characters std::string stores inline, so every string
+    // built from it allocates, like most real uniform names would
+    const char* const longUniformName = "sprite_blend_amount";
+
+    enum class UniformPath
+    {
+        Driver, // glGetUniformLocation on every call, what Shader used to do
+        String, // setUniform(std::string), the cached table behind a string key
+        Hashed, // setUniform("name"_u), hash computed at compile time
+        Handle  // UniformHandle resolved once up front
+    };
+
+    // Sets one uniform many times per frame through each lookup path, and
+    // counts the heap allocations those calls make. Only the paths going
+    // through a std::string should allocate.
+    class UniformScenario : public BenchScenario
+    {
+        UniformPath _path;
+        Shader* _shader = nullptr;
+        UniformHandle _handle;
+        unsigned long long _allocations = 0;
+        int _frames = 0;
+
+        public:
+            explicit UniformScenario(UniformPath path) : _path(path) {}
+            ~UniformScenario() { delete _shader; }
+
+            void setup() override
+            {
+                _shader = new Shader("shaders/sprite.vs", "shaders/sprite_blend.fs");
+                _shader->use();
+                _handle = _shader->uniform("sprite_blend_amount"_u);
+                benchCheck(_handle.location >= 0, "long uniform name resolves");
+            }
+
+            void frame() override
+            {
+                unsigned long long before = benchAllocations();
+                for (int i = 0; i < uniformSetsPerFrame; i++)
+                {
+                    float value = (float) (i & 1);
+                    switch (_path)
+                    {
+                        case UniformPath::Driver:
+                        {
+                            GLint program = 0;
+                            glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+                            glUniform1f(glGetUniformLocation(program, std::string(longUniformName).c_str()), value);
+                            break;
+                        }
+                        case UniformPath::String:
+                            _shader->setUniform(std::string(longUniformName), value);
+                            break;
+                        case UniformPath::Hashed:
+                            _shader->setUniform("sprite_blend_amount"_u, value);
+                            break;
+                        case UniformPath::Handle:
+                            _shader->setUniform(_handle, value);
+                            break;
+                    }
+                }
+                _allocations += benchAllocations() - before;
+                _frames++;
+            }
+
+            void metrics(std::vector<BenchMetric> &out) const override
+            {
+                double perFrame = (double) _allocations / _frames;
+                if (_path == UniformPath::Hashed || _path == UniformPath::Handle)
+                    benchCheck(_allocations == 0, "no allocations setting uniforms by id or handle");
+                else
+                    benchCheck(perFrame >= uniformSetsPerFrame, "an allocation per uniform set by std::string name");
+                out.push_back({ "allocations_per_frame", perFrame, "allocs" });
+            }
+    };
+
+    // Writes a vertex/fragment pair whose source is unique to variant, so
+    // neither our program cache nor the driver's own has seen it before.
+    // helpers adds that many small functions to each, for realistic sizes.
+    void writeShaderPair(const std::string &directory, const std::string &variant,
+                         std::string &vertexPath, std::string &fragPath, int helpers = 0)
+    {
+        vertexPath = directory + "/" + variant + ".vs";
+        fragPath = directory + "/" + variant + ".fs";
+
+        std::string helperCode;
+        for (int i = 0; i < helpers; i++)
+            helperCode += "float helper" + std::to_string(i) + "(float x) { return x * " + std::to_string(i)
+                        + ".0 + 0.5; }\n";
+
+        std::ofstream vertex(vertexPath);
+        vertex << "#version 330 core\n"
+               << helperCode
+               << "layout (location = 0) in vec3 aPos;\n"
+               << "layout (location = 1) in vec2 aTexCoord;\n"
+               << "out vec2 texCoord;\n"
+               << "uniform float offset;\n"
+               << "void main()\n{\n"
+               << "    // variant " << variant << "\n"
+               << "    gl_Position = vec4(aPos.x + offset, aPos.yz, 1.0);\n"
+               << "    texCoord = aTexCoord;\n}\n";
+
+        std::ofstream frag(fragPath);
+        frag << "#version 330 core\n"
+             << helperCode
+             << "in vec2 texCoord;\n"
+             << "out vec4 FragColor;\n"
+             << "uniform sampler2D texture1;\n"
+             << "uniform float mix_amount;\n"
+             << "void main()\n{\n"
+             << "    // variant " << variant << "\n"
+             << "    vec4 color = texture(texture1, texCoord);\n"
+             << "    FragColor = mix(color, vec4(texCoord, 0.0, 1.0), mix_amount);\n}\n";
+    }
+
+    // Time to build one Shader, from a cold or a warm program cache
+    class ShaderStartupScenario : public BenchScenario
+    {
+        bool _warm;
+        int _run = 0;
+        std::string _directory;
+
+        public:
+            explicit ShaderStartupScenario(bool warm) : _warm(warm) {}
+
+            int frames(int requested) const override { return std::min(requested, 50); }
+
+            void setup() override
+            {
+                _directory = benchTempDirectory() + (_warm ? "/startup_warm" : "/startup_cold");
+                std::filesystem::create_directories(_directory);
+                ProgramCache::setDirectory(_directory + "/cache");
+
+                // Warm runs build the same program every frame, starting with
+                // one that filled the cache
+                if (_warm)
+                {
+                    std::string vertexPath, fragPath;
+                    writeShaderPair(_directory, "warm", vertexPath, fragPath);
+                    Shader shader { vertexPath.c_str(), fragPath.c_str() };
+                }
+            }
+
+            void frame() override
+            {
+                std::string variant = _warm ? "warm" : "cold" + std::to_string(_run++);
+                std::string vertexPath, fragPath;
+                if (!_warm)
+                    writeShaderPair(_directory, variant, vertexPath, fragPath);
+                else
+                {
+                    vertexPath = _directory + "/warm.vs";
+                    fragPath = _directory + "/warm.fs";
+                }
+
+                Shader shader { vertexPath.c_str(), fragPath.c_str() };
+            }
+
+            void metrics(std::vector<BenchMetric> &out) const override
+            {
+                out.push_back({ "cache_hits", (double) ProgramCache::stats().hits, "programs", false });
+            }
+    };
+
+    // Startup I/O: getting the sources of a few hundred shader files into
+    // GL, without compiling them. Streamed is what Shader used to do (an
+    // ifstream through a stringstream into a std::string per file), direct
+    // is ShaderPreprocessor handing its ShaderSource pieces straight to
+    // glShaderSource. Files stay in the page cache between frames.
+    class ShaderSourceLoadScenario : public BenchScenario
+    {
+        bool _direct;
+        int _pairs;
+        std::vector<std::string> _paths;
+        GLuint _shader = 0;
+        size_t _bytes = 0;
+        unsigned long long _allocations = 0;
+        int _frames = 0;
+
+        static std::string streamFile(const std::string &path)
+        {
+            std::ifstream file;
+            file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+            try
+            {
+                file.open(path);
+                std::stringstream stream;
+                stream << file.rdbuf();
+                file.close();
+                return stream.str();
+            }
+            catch (const std::ifstream::failure&)
+            {
+                return std::string();
+            }
+        }
+
+        public:
+            ShaderSourceLoadScenario(bool direct, int pairs) : _direct(direct), _pairs(pairs) {}
+            ~ShaderSourceLoadScenario() { glDeleteShader(_shader); }
+
+            void setup() override
+            {
+                std::string directory = benchTempDirectory() + (_direct ? "/load_direct" : "/load_streamed");
+                std::filesystem::create_directories(directory);
+                for (int i = 0; i < _pairs; i++)
+                {
+                    std::string vertexPath, fragPath;
+                    writeShaderPair(directory, "pair" + std::to_string(i), vertexPath, fragPath, 60);
+                    _paths.push_back(vertexPath);
+                    _paths.push_back(fragPath);
+                }
+
+                // Only receives sources, never compiled
+                _shader = glCreateShader(GL_FRAGMENT_SHADER);
+            }
+
+            void frame() override
+            {
+                unsigned long long before = benchAllocations();
+                _bytes = 0;
+                ShaderSource source;
+                for (const std::string &path : _paths)
+                {
+                    if (_direct)
+                    {
+                        ShaderPreprocessor::process(path, ShaderDefines(), source);
+                        glShaderSource(_shader, source.count(), source.strings(), source.lengths());
+                        _bytes += source.size();
+                    }
+                    else
+                    {
+                        std::string code = streamFile(path);
+                        const char* data = code.c_str();
+                        glShaderSource(_shader, 1, &data, NULL);
+                        _bytes += code.size();
+                    }
+                }
+                _allocations += benchAllocations() - before;
+                _frames++;
+            }
+
+            void metrics(std::vector<BenchMetric> &out) const override
+            {
+                out.push_back({ "files_per_frame", (double) _paths.size(), "files", false });
+                out.push_back({ "source_bytes_per_frame", (double) _bytes, "bytes", false });
+                out.push_back({ "allocations_per_frame", (double) _allocations / _frames, "allocs" });
+            }
+    };
+
+    // Dozens of never-seen programs per frame, one Shader at a time or all
+    // through a ShaderBatch
+    class ShaderBatchScenario : public BenchScenario
+    {
+        bool _batched;
+        int _programs;
+        int _run = 0;
+        std::string _directory;
+
+        public:
+            ShaderBatchScenario(bool batched, int programs) : _batched(batched), _programs(programs) {}
+
+            int frames(int requested) const override { return std::min(requested, 5); }
+
+            void setup() override
+            {
+                _directory = benchTempDirectory() + (_batched ? "/batched" : "/sequential");
+                std::filesystem::create_directories(_directory);
+                ProgramCache::setDirectory(_directory + "/cache");
+                if (!_batched)
+                    return;
+
+                // Polling before submit() must still get there: ready()
+                // submits what's pending instead of querying program 0
+                std::string vertexPath, fragPath;
+                writeShaderPair(_directory, "unsubmitted", vertexPath, fragPath);
+                ShaderBatch batch;
+                batch.add(vertexPath.c_str(), fragPath.c_str());
+                auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+                bool ready = false;
+                while (!(ready = batch.ready()) && std::chrono::steady_clock::now() < deadline)
+                    ;
+                benchCheck(ready, "batch polled without submit() becomes ready");
+
+                Shader shader = batch.take(0);
+                GLint linked = GL_FALSE;
+                glGetProgramiv(shader.handle(), GL_LINK_STATUS, &linked);
+                benchCheck(linked == GL_TRUE, "batch polled without submit() links its program");
+            }
+
+            void frame() override
+            {
+                std::vector<std::string> vertexPaths(_programs);
+                std::vector<std::string> fragPaths(_programs);
+                for (int i = 0; i < _programs; i++)
+                {
+                    std::string variant = "run" + std::to_string(_run) + "_" + std::to_string(i);
+                    writeShaderPair(_directory, variant, vertexPaths[i], fragPaths[i]);
+                }
+                _run++;
+
+                if (!_batched)
+                {
+                    for (int i = 0; i < _programs; i++)
+                        Shader shader { vertexPaths[i].c_str(), fragPaths[i].c_str() };
+                    return;
+                }
+
+                ShaderBatch batch;
+                for (int i = 0; i < _programs; i++)
+                    batch.add(vertexPaths[i].c_str(), fragPaths[i].c_str());
+                batch.submit();
+                while (!batch.ready())
+                    ;
+                for (size_t i = 0; i < batch.size(); i++)
+                    Shader shader = batch.take(i);
+            }
+
+            void metrics(std::vector<BenchMetric> &out) const override
+            {
+                out.push_back({ "programs_per_frame", (double) _programs, "programs", false });
+            }
+    };
+
+    bool registered = registerBench("uniform_driver_lookup", benchFactory<UniformScenario>(UniformPath::Driver))
+        && registerBench("uniform_string", benchFactory<UniformScenario>(UniformPath::String))
+        && registerBench("uniform_hashed", benchFactory<UniformScenario>(UniformPath::Hashed))
+        && registerBench("uniform_handle", benchFactory<UniformScenario>(UniformPath::Handle))
+        && registerBench("shader_startup_cold", benchFactory<ShaderStartupScenario>(false))
+        && registerBench("shader_startup_warm", benchFactory<ShaderStartupScenario>(true))
+        && registerBench("shader_load_streamed", benchFactory<ShaderSourceLoadScenario>(false, 200))
+        && registerBench("shader_load_direct", benchFactory<ShaderSourceLoadScenario>(true, 200))
+        && registerBench("shader_compile_sequential", benchFactory<ShaderBatchScenario>(false, 48))
+        && registerBench("shader_compile_batched", benchFactory<ShaderBatchScenario>(true, 48));
+}
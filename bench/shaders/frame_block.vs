@@ -0,0 +1,19 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aColor;
+
+out vec3 ourColor;
+
+// Filled once per frame from a UniformBlock<FrameData>
+layout (std140) uniform FrameData
+{
+    mat4 viewProjection;
+    vec2 viewport;
+    float time;
+};
+
+void main()
+{
+    gl_Position = viewProjection * vec4(aPos + vec3(sin(time) * 0.1, 0.0, 0.0), 1.0);
+    ourColor = aColor * (viewport.x / 800.0);
+}
@@ -0,0 +1,16 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aColor;
+
+out vec3 ourColor;
+
+// The same per-frame data as frame_block.vs, as plain uniforms
+uniform mat4 viewProjection;
+uniform vec2 viewport;
+uniform float time;
+
+void main()
+{
+    gl_Position = viewProjection * vec4(aPos + vec3(sin(time) * 0.1, 0.0, 0.0), 1.0);
+    ourColor = aColor * (viewport.x / 800.0);
+}
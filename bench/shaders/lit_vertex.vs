@@ -0,0 +1,15 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+layout (location = 3) in vec4 aColor;
+
+out vec4 color;
+
+// Reads every attribute, so each one has to be fetched
+void main()
+{
+    gl_Position = vec4(aPos, 1.0);
+    float light = 0.25 + 0.75 * max(dot(normalize(aNormal), vec3(0.0, 0.0, 1.0)), 0.0);
+    color = vec4(aColor.rgb * light * (0.5 + 0.5 * aTexCoord.x), aColor.a);
+}
@@ -0,0 +1,13 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aColor;
+layout (location = 2) in vec2 aTexCoord;
+
+out vec4 color;
+
+// Same output as the quantized version written by mesh_quantization_scenarios.cpp
+void main()
+{
+    gl_Position = vec4(aPos, 1.0);
+    color = vec4(aColor * (0.75 + 0.25 * sin(aTexCoord.x)), 1.0);
+}
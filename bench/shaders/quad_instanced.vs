@@ -0,0 +1,18 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aColor;
+layout (location = 2) in vec2 aTexCoord;
+
+// Per instance
+layout (location = 3) in vec4 iOffsetScale;
+layout (location = 4) in vec3 iColor;
+
+out vec3 color;
+out vec2 texCoord;
+
+void main()
+{
+    gl_Position = vec4(aPos * iOffsetScale.w + iOffsetScale.xyz, 1.0);
+    color = aColor * iColor;
+    texCoord = aTexCoord;
+}
@@ -0,0 +1,17 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aColor;
+layout (location = 2) in vec2 aTexCoord;
+
+out vec3 color;
+out vec2 texCoord;
+
+uniform vec4 offsetScale;
+uniform vec3 tint;
+
+void main()
+{
+    gl_Position = vec4(aPos * offsetScale.w + offsetScale.xyz, 1.0);
+    color = aColor * tint;
+    texCoord = aTexCoord;
+}
@@ -0,0 +1,12 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 color;
+in vec2 texCoord;
+
+uniform sampler2D sprite;
+
+void main()
+{
+    FragColor = texture(sprite, texCoord) * vec4(color, 1.0);
+}
@@ -0,0 +1,14 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 color;
+in vec2 texCoord;
+
+uniform sampler2D sprite;
+// Longer than std::string keeps inline, so building one allocates
+uniform float sprite_blend_amount;
+
+void main()
+{
+    FragColor = mix(texture(sprite, texCoord), vec4(color, 1.0), sprite_blend_amount);
+}
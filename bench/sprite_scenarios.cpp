@@ -0,0 +1,177 @@
+#include "bench.hpp"
+#include "../wrappers/batch_renderer.hpp"
+#include "../wrappers/gl_state.hpp"
+#include "../wrappers/shader.hpp"
+#include <glad/glad.h>
+#include <algorithm>
+
+// Thousands of small textured quads spread over a handful of textures,
+// interleaved so that submission order alone never groups them
+
+namespace
+{
+    const int gridSize = 100; // 10k sprites
+    const int textureCount = 4;
+
+    struct Sprite
+    {
+        float x, y, size;
+        float color[3];
+        int texture;
+    };
+
+    // Base for the sprite scenarios: the shader, textures and sprite list
+    class SpriteScenario : public BenchScenario
+    {
+        protected:
+        Shader* _shader = nullptr;
+        GLuint _textures[textureCount] = {};
+        std::vector<Sprite> _sprites;
+        unsigned _drawCalls = 0;
+
+        public:
+            ~SpriteScenario()
+            {
+                GLState::deleteTextures(textureCount, _textures);
+                delete _shader;
+            }
+
+            void setup() override
+            {
+                _shader = new Shader("shaders/sprite.vs", "shaders/sprite.fs");
+                _shader->use();
+                _shader->setUniform("sprite"_u, 0);
+
+                // Small solid-color textures are enough, sampling isn't what's measured
+                glGenTextures(textureCount, _textures);
+                for (int i = 0; i < textureCount; i++)
+                {
+                    unsigned char pixels[4 * 4 * 4];
+                    for (int j = 0; j < 16; j++)
+                    {
+                        pixels[j * 4 + 0] = (unsigned char) (64 * i);
+                        pixels[j * 4 + 1] = (unsigned char) (255 - 64 * i);
+                        pixels[j * 4 + 2] = 128;
+                        pixels[j * 4 + 3] = 255;
+                    }
+                    GLState::bindTexture(GL_TEXTURE_2D, _textures[i]);
+                    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 4, 4, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+                }
+
+                float step = 2.0f / gridSize;
+                for (int y = 0; y < gridSize; y++)
+                {
+                    for (int x = 0; x < gridSize; x++)
+                    {
+                        int i = y * gridSize + x;
+                        _sprites.push_back({ -1.0f + x * step, -1.0f + y * step, step * 0.8f,
+                                             { 1.0f, (float) x / gridSize, (float) y / gridSize },
+                                             (i * 7) % textureCount });
+                    }
+                }
+            }
+
+            void metrics(std::vector<BenchMetric> &out) const override
+            {
+                out.push_back({ "sprites", (double) _sprites.size(), "sprites", false });
+                out.push_back({ "draw_calls", (double) _drawCalls, "draws" });
+            }
+    };
+
+    // One VAO and one draw per sprite, like hello_triangle/exercise2
+    class NaiveSpriteScenario : public SpriteScenario
+    {
+        std::vector<GLuint> _vaos;
+        std::vector<GLuint> _buffers;
+
+        public:
+            ~NaiveSpriteScenario()
+            {
+                GLState::deleteVertexArrays(_vaos.size(), _vaos.data());
+                GLState::deleteBuffers(_buffers.size(), _buffers.data());
+            }
+
+            // Hundreds of ms per frame on llvmpipe
+            int frames(int requested) const override { return std::min(requested, 20); }
+
+            void setup() override
+            {
+                SpriteScenario::setup();
+
+                static const GLuint indices[6] = { 0, 1, 3, 1, 2, 3 };
+                _vaos.resize(_sprites.size());
+                _buffers.resize(_sprites.size() * 2);
+                glGenVertexArrays(_vaos.size(), _vaos.data());
+                glGenBuffers(_buffers.size(), _buffers.data());
+
+                for (size_t i = 0; i < _sprites.size(); i++)
+                {
+                    const Sprite &s = _sprites[i];
+                    const float* c = s.color;
+                    float vertices[] = {
+                        s.x + s.size, s.y + s.size, 0.0f,   c[0], c[1], c[2],   1.0f, 1.0f,
+                        s.x + s.size, s.y, 0.0f,            c[0], c[1], c[2],   1.0f, 0.0f,
+                        s.x, s.y, 0.0f,                     c[0], c[1], c[2],   0.0f, 0.0f,
+                        s.x, s.y + s.size, 0.0f,            c[0], c[1], c[2],   0.0f, 1.0f
+                    };
+
+                    GLState::bindVertexArray(_vaos[i]);
+                    GLState::bindBuffer(GL_ARRAY_BUFFER, _buffers[i * 2]);
+                    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+                    GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, _buffers[i * 2 + 1]);
+                    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+                    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+                    glEnableVertexAttribArray(0);
+                    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+                    glEnableVertexAttribArray(1);
+                    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+                    glEnableVertexAttribArray(2);
+                }
+                GLState::bindVertexArray(0);
+            }
+
+            void frame() override
+            {
+                glClear(GL_COLOR_BUFFER_BIT);
+                _shader->use();
+                GLState::activeTexture(GL_TEXTURE0);
+                for (size_t i = 0; i < _sprites.size(); i++)
+                {
+                    GLState::bindTexture(GL_TEXTURE_2D, _textures[_sprites[i].texture]);
+                    GLState::bindVertexArray(_vaos[i]);
+                    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+                }
+                _drawCalls = _sprites.size();
+            }
+    };
+
+    // Every sprite resubmitted to a BatchRenderer each frame
+    class BatchedSpriteScenario : public SpriteScenario
+    {
+        BatchRenderer* _batch = nullptr;
+
+        public:
+            ~BatchedSpriteScenario() { delete _batch; }
+
+            void setup() override
+            {
+                SpriteScenario::setup();
+                _batch = new BatchRenderer();
+            }
+
+            void frame() override
+            {
+                glClear(GL_COLOR_BUFFER_BIT);
+                _batch->begin();
+                for (const Sprite &s : _sprites)
+                    _batch->sprite(*_shader, _textures[s.texture], s.x, s.y, s.size, s.size, s.color);
+                _batch->end();
+                _drawCalls = _batch->stats().drawCalls;
+            }
+    };
+
+    bool registered = registerBench("sprites_naive", benchFactory<NaiveSpriteScenario>())
+        && registerBench("sprites_batched", benchFactory<BatchedSpriteScenario>());
+}
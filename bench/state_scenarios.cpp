@@ -0,0 +1,123 @@
+#include "bench.hpp"
+#include "../wrappers/gl_state.hpp"
+#include "../wrappers/shader.hpp"
+#include <glad/glad.h>
+
+// A typical object loop: every object sets its program, texture and VAO
+// before drawing, whether or not the previous object already did. Objects
+// are sorted by material, so nearly all of those calls are redundant.
+
+namespace
+{
+    class StateScenario : public BenchScenario
+    {
+        static const int Materials = 4;
+
+        bool _cached;
+        int _objects;
+        Shader* _shaders[2] = {};
+        GLuint _textures[2] = {};
+        GLuint _vao = 0;
+        GLuint _vbo = 0;
+
+        GLState::Stats _total;
+        int _frames = 0;
+
+        public:
+            StateScenario(bool cached, int objects) : _cached(cached), _objects(objects) {}
+
+            ~StateScenario()
+            {
+                GLState::deleteVertexArrays(1, &_vao);
+                GLState::deleteBuffers(1, &_vbo);
+                GLState::deleteTextures(2, _textures);
+                delete _shaders[0];
+                delete _shaders[1];
+            }
+
+            void setup() override
+            {
+                // Same sources twice still gives two programs to switch between
+                for (Shader* &shader : _shaders)
+                    shader = new Shader("../shaders/vertexShader1.glsl", "../shaders/fragShader1.glsl");
+
+                unsigned char pixels[2][4] = { { 255, 0, 0, 255 }, { 0, 0, 255, 255 } };
+                glGenTextures(2, _textures);
+                for (int i = 0; i < 2; i++)
+                {
+                    GLState::bindTexture(GL_TEXTURE_2D, _textures[i]);
+                    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels[i]);
+                }
+
+                float vertices[] = {
+                    0.5f, -0.5f, 0.0f,  1.0f, 0.0f, 0.0f,
+                    -0.5f, -0.5f, 0.0f,  0.0f, 1.0f, 0.0f,
+                    0.0f,  0.5f, 0.0f,  0.0f, 0.0f, 1.0f
+                };
+
+                glGenVertexArrays(1, &_vao);
+                glGenBuffers(1, &_vbo);
+                GLState::bindVertexArray(_vao);
+                GLState::bindBuffer(GL_ARRAY_BUFFER, _vbo);
+                glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+                glEnableVertexAttribArray(0);
+                glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+                glEnableVertexAttribArray(1);
+            }
+
+            void frame() override
+            {
+                GLState::Stats before = GLState::stats();
+
+                glClear(GL_COLOR_BUFFER_BIT);
+                for (int i = 0; i < _objects; i++)
+                {
+                    // Material changes every _objects / Materials objects
+                    int material = i * Materials / _objects;
+                    Shader &shader = *_shaders[material / 2];
+                    GLuint texture = _textures[material % 2];
+
+                    if (_cached)
+                    {
+                        shader.use();
+                        GLState::activeTexture(GL_TEXTURE0);
+                        GLState::bindTexture(GL_TEXTURE_2D, texture);
+                        GLState::bindVertexArray(_vao);
+                    }
+                    else
+                    {
+                        // Behind the cache's back, so it can't trust itself afterwards
+                        glUseProgram(shader.handle());
+                        glActiveTexture(GL_TEXTURE0);
+                        glBindTexture(GL_TEXTURE_2D, texture);
+                        glBindVertexArray(_vao);
+                    }
+                    glDrawArrays(GL_TRIANGLES, 0, 3);
+                }
+
+                if (_cached)
+                {
+                    const GLState::Stats &after = GLState::stats();
+                    _total.issued += after.issued - before.issued;
+                    _total.elided += after.elided - before.elided;
+                }
+                else
+                {
+                    GLState::invalidate();
+                    _total.issued += (std::uint64_t) _objects * 4;
+                }
+                _frames++;
+            }
+
+            void metrics(std::vector<BenchMetric> &out) const override
+            {
+                double frames = _frames > 0 ? _frames : 1;
+                out.push_back({ "state_calls_issued", _total.issued / frames, "calls" });
+                out.push_back({ "state_calls_elided", _total.elided / frames, "calls", false });
+            }
+    };
+
+    bool registered = registerBench("state_raw", benchFactory<StateScenario>(false, 5000))
+        && registerBench("state_cached", benchFactory<StateScenario>(true, 5000));
+}
@@ -0,0 +1,143 @@
+#include "bench.hpp"
+#include "../wrappers/gl_state.hpp"
+#include "../wrappers/shader.hpp"
+#include "../wrappers/static_draw_list.hpp"
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+
+// A static scene of 50k small meshes (quads, pre-transformed), submitted
+// with one draw per object, one glMultiDrawElementsBaseVertex, or one
+// glMultiDrawElementsIndirect. submit_ms is the CPU time of the draw
+// calls alone.
+
+namespace
+{
+    const int objectCount = 50000;
+
+    enum class SubmitMode
+    {
+        Loop,
+        MultiDraw,
+        Indirect
+    };
+
+    class StaticSceneScenario : public BenchScenario
+    {
+        SubmitMode _mode;
+        Shader* _shader = nullptr;
+        GLuint _texture = 0;
+        StaticDrawList* _list = nullptr;
+
+        // Loop mode keeps the same packed geometry itself
+        GLuint _vao = 0;
+        GLuint _vbo = 0;
+        GLuint _ebo = 0;
+
+        double _submitMs = 0.0;
+        int _frames = 0;
+
+        public:
+            explicit StaticSceneScenario(SubmitMode mode) : _mode(mode) {}
+
+            ~StaticSceneScenario()
+            {
+                GLState::deleteVertexArrays(1, &_vao);
+                GLState::deleteBuffers(1, &_vbo);
+                GLState::deleteBuffers(1, &_ebo);
+                GLState::deleteTextures(1, &_texture);
+                delete _list;
+                delete _shader;
+            }
+
+            int frames(int requested) const override { return std::min(requested, 50); }
+
+            void setup() override
+            {
+                _shader = new Shader("shaders/sprite.vs", "shaders/sprite.fs");
+                _shader->use();
+                _shader->setUniform("sprite"_u, 0);
+
+                unsigned char white[4] = { 255, 255, 255, 255 };
+                glGenTextures(1, &_texture);
+                GLState::bindTexture(GL_TEXTURE_2D, _texture);
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+                _list = new StaticDrawList(_mode == SubmitMode::Indirect);
+
+                std::vector<BatchVertex> allVertices;
+                std::vector<GLuint> allIndices;
+                static const GLuint indices[6] = { 0, 1, 3, 1, 2, 3 };
+                int side = 224; // ceil(sqrt(objectCount))
+                float step = 2.0f / side;
+                for (int i = 0; i < objectCount; i++)
+                {
+                    float x = -1.0f + (i % side) * step;
+                    float y = -1.0f + (i / side) * step;
+                    float s = step * 0.8f;
+                    float g = (float) (i % side) / side;
+                    BatchVertex vertices[4] = {
+                        { { x + s, y + s, 0.0f }, { 1.0f, g, 0.5f }, { 1.0f, 1.0f } },
+                        { { x + s, y, 0.0f },     { 1.0f, g, 0.5f }, { 1.0f, 0.0f } },
+                        { { x, y, 0.0f },         { 1.0f, g, 0.5f }, { 0.0f, 0.0f } },
+                        { { x, y + s, 0.0f },     { 1.0f, g, 0.5f }, { 0.0f, 1.0f } }
+                    };
+                    _list->add(vertices, 4, indices, 6);
+                    allVertices.insert(allVertices.end(), vertices, vertices + 4);
+                    allIndices.insert(allIndices.end(), indices, indices + 6);
+                }
+                _list->build();
+
+                if (_mode == SubmitMode::Loop)
+                {
+                    glGenVertexArrays(1, &_vao);
+                    glGenBuffers(1, &_vbo);
+                    glGenBuffers(1, &_ebo);
+                    GLState::bindVertexArray(_vao);
+                    GLState::bindBuffer(GL_ARRAY_BUFFER, _vbo);
+                    glBufferData(GL_ARRAY_BUFFER, allVertices.size() * sizeof(BatchVertex), allVertices.data(),
+                                 GL_STATIC_DRAW);
+                    GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ebo);
+                    glBufferData(GL_ELEMENT_ARRAY_BUFFER, allIndices.size() * sizeof(GLuint), allIndices.data(),
+                                 GL_STATIC_DRAW);
+                    BatchVertexLayout::apply();
+                    GLState::bindVertexArray(0);
+                }
+            }
+
+            void frame() override
+            {
+                glClear(GL_COLOR_BUFFER_BIT);
+                _shader->use();
+                GLState::activeTexture(GL_TEXTURE0);
+                GLState::bindTexture(GL_TEXTURE_2D, _texture);
+
+                auto start = std::chrono::steady_clock::now();
+                if (_mode == SubmitMode::Loop)
+                {
+                    GLState::bindVertexArray(_vao);
+                    for (int i = 0; i < objectCount; i++)
+                        glDrawElementsBaseVertex(GL_TRIANGLES, 6, GL_UNSIGNED_INT,
+                                                 (void*) (i * 6 * sizeof(GLuint)), i * 4);
+                }
+                else
+                {
+                    _list->draw();
+                }
+                _submitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                _frames++;
+            }
+
+            void metrics(std::vector<BenchMetric> &out) const override
+            {
+                out.push_back({ "objects", (double) objectCount, "objects", false });
+                out.push_back({ "submit_ms", _submitMs / _frames, "ms" });
+                out.push_back({ "indirect", _list->indirect() ? 1.0 : 0.0, "bool", false });
+            }
+    };
+
+    bool registered = registerBench("static_scene_loop", benchFactory<StaticSceneScenario>(SubmitMode::Loop))
+        && registerBench("static_scene_multidraw", benchFactory<StaticSceneScenario>(SubmitMode::MultiDraw))
+        && registerBench("static_scene_indirect", benchFactory<StaticSceneScenario>(SubmitMode::Indirect));
+}
@@ -0,0 +1,309 @@
+#include "bench.hpp"
+#include "../wrappers/batch_renderer.hpp"
+#include "../wrappers/gl_state.hpp"
+#include "../wrappers/mipmap.hpp"
+#include "../wrappers/shader.hpp"
+#include "../wrappers/texture_cache.hpp"
+#include "../wrappers/texture_file.hpp"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// TextureCache the way a sample drives it: handles from get(), bind() in
+// the draw loop, pump() and beginFrame() once a frame. Each scenario also
+// checks that the cache does what it claims (see benchCheck()).
+
+namespace
+{
+    const int textureSize = 128;
+
+    // Solid color per texture, so a pixel tells which one was drawn
+    void textureColor(int index, unsigned char rgba[4])
+    {
+        rgba[0] = (unsigned char) (40 + index * 25);
+        rgba[1] = (unsigned char) (220 - index * 20);
+        rgba[2] = (unsigned char) (index * 30);
+        rgba[3] = 255;
+    }
+
+    // Baked, so loading is a map and the scenario times the cache, not stb_image.
+    // Returns the bytes one texture takes on the GPU, all levels included.
+    size_t writeTextures(int count, std::vector<std::string> &paths)
+    {
+        size_t bytes = 0;
+        for (int i = 0; i < count; i++)
+        {
+            unsigned char rgba[4];
+            textureColor(i, rgba);
+            std::vector<unsigned char> pixels((size_t) textureSize * textureSize * 4);
+            for (size_t p = 0; p < pixels.size(); p++)
+                pixels[p] = rgba[p % 4];
+
+            std::vector<MipLevel> chain = buildMipChain(pixels.data(), textureSize, textureSize, 4);
+            paths.push_back(benchTempDirectory() + "/cached" + std::to_string(i) + ".txb");
+            TextureFile::write(paths.back().c_str(), chain, 4);
+
+            bytes = 0;
+            for (const MipLevel &level : chain)
+                bytes += level.pixels.size();
+        }
+        return bytes;
+    }
+
+    // Full-screen quad, white so the texture shows as is
+    GLuint createQuad(GLuint &vbo)
+    {
+        BatchVertex quad[] = {
+            { { -1.0f, -1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } },
+            { { 1.0f, -1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 1.0f, 0.0f } },
+            { { -1.0f, 1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 1.0f } },
+            { { 1.0f, 1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 1.0f, 1.0f } }
+        };
+        glGenBuffers(1, &vbo);
+        GLuint vao = BatchVertexLayout::createVertexArray(vbo);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+        return vao;
+    }
+
+    // Draws the texture on unit 0 and reads back the middle pixel
+    bool drawsColor(const unsigned char expected[4])
+    {
+        glClear(GL_COLOR_BUFFER_BIT);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        unsigned char pixel[4];
+        glReadPixels(400, 300, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+        for (int i = 0; i < 3; i++)
+            if (std::abs(pixel[i] - expected[i]) > 1)
+                return false;
+        return true;
+    }
+
+    GLint boundTextureWidth()
+    {
+        GLint width = 0;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+        return width;
+    }
+
+    // More textures than the budget holds, two drawn a frame and the pair
+    // moving on every few frames, so the rest are evicted and reloaded as
+    // they come back around
+    class TextureCacheBudgetScenario : public BenchScenario
+    {
+        static const int textureCount = 8;
+        static const int budgetTextures = 3;
+        static const int framesPerPair = 4;
+
+        TextureLoader* _loader = nullptr;
+        TextureCache* _cache = nullptr;
+        Shader* _shader = nullptr;
+        std::vector<TextureHandle> _textures;
+        GLuint _vao = 0;
+        GLuint _vbo = 0;
+        size_t _textureBytes = 0;
+        size_t _maxResident = 0;
+        unsigned _frame = 0;
+
+        public:
+            ~TextureCacheBudgetScenario()
+            {
+                // Handles before the cache, the cache before its loader
+                _textures.clear();
+                delete _cache;
+                delete _loader;
+                delete _shader;
+                GLState::deleteVertexArrays(1, &_vao);
+                GLState::deleteBuffers(1, &_vbo);
+            }
+
+            void setup() override
+            {
+                std::vector<std::string> paths;
+                _textureBytes = writeTextures(textureCount, paths);
+
+                _shader = new Shader("shaders/sprite.vs", "shaders/sprite.fs");
+                _shader->use();
+                _vao = createQuad(_vbo);
+
+                // Room for three and a half textures
+                _loader = new TextureLoader();
+                _cache = new TextureCache(*_loader, budgetTextures * _textureBytes + _textureBytes / 2);
+                for (const std::string &path : paths)
+                    _textures.push_back(_cache->get(path.c_str()));
+                _loader->finish();
+
+                // Everything was asked for this frame, so it all stays for now
+                benchCheck(_cache->stats().evictions == 0, "nothing evicted in the frame textures were requested");
+
+                // From the next frame on, the oldest go until under budget
+                _cache->beginFrame();
+                benchCheck(_cache->residentBytes() <= _cache->budget(), "resident bytes within budget after beginFrame");
+                benchCheck(_cache->stats().evictions == textureCount - budgetTextures, "textures over budget evicted");
+                benchCheck(_textures[0].id() == 0, "least recently used texture evicted first");
+
+                // Binding an evicted texture reloads it, showing the
+                // placeholder until the image is back
+                unsigned char white[4] = { 255, 255, 255, 255 };
+                unsigned char first[4];
+                textureColor(0, first);
+
+                _textures[0].bind(0);
+                benchCheck(_cache->stats().reloads == 1, "binding an evicted texture reloads it");
+                benchCheck(_cache->stats().reloadStalls == 1, "bind during reload counted as a stall");
+                benchCheck(_textures[0].id() != 0 && boundTextureWidth() == 1, "placeholder bound while reloading");
+                benchCheck(drawsColor(white), "placeholder drawn while reloading");
+
+                _loader->finish();
+                benchCheck(boundTextureWidth() == textureSize, "real image in place after reload");
+                benchCheck(drawsColor(first), "real image drawn after reload");
+                benchCheck(_cache->residentBytes() <= _cache->budget(), "resident bytes within budget after reload");
+            }
+
+            void frame() override
+            {
+                _cache->beginFrame();
+                _loader->pump();
+
+                glClear(GL_COLOR_BUFFER_BIT);
+                _shader->use();
+                GLState::bindVertexArray(_vao);
+
+                size_t first = (_frame / framesPerPair) % textureCount;
+                for (size_t i = 0; i < 2; i++)
+                {
+                    _textures[(first + i) % textureCount].bind(0);
+                    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+                }
+
+                _maxResident = std::max(_maxResident, _cache->residentBytes());
+                _frame++;
+            }
+
+            void metrics(std::vector<BenchMetric> &out) const override
+            {
+                benchCheck(_maxResident <= _cache->budget(), "resident bytes never over budget");
+                if (_frame > framesPerPair * textureCount)
+                {
+                    benchCheck(_cache->stats().evictions > textureCount - budgetTextures,
+                               "textures evicted as the working set moves");
+                    benchCheck(_cache->stats().reloads > 1, "textures reloaded as the working set comes back");
+                }
+
+                out.push_back({ "budget_kb", _cache->budget() / 1024.0, "KB" });
+                out.push_back({ "resident_max_kb", _maxResident / 1024.0, "KB" });
+                out.push_back({ "evictions", (double) _cache->stats().evictions, "count" });
+                out.push_back({ "reloads", (double) _cache->stats().reloads, "count" });
+                out.push_back({ "reload_stalls", (double) _cache->stats().reloadStalls, "count" });
+            }
+    };
+
+    // One image asked for under different spellings of its path, every
+    // frame, the way unrelated parts of a program would. Each get() is a
+    // lookup; only a different sampler or flip makes a new texture.
+    class TextureCacheSharingScenario : public BenchScenario
+    {
+        TextureLoader* _loader = nullptr;
+        TextureCache* _cache = nullptr;
+        Shader* _shader = nullptr;
+        TextureHandle _kept;
+        GLuint _vao = 0;
+        GLuint _vbo = 0;
+        size_t _created = 0;
+
+        public:
+            ~TextureCacheSharingScenario()
+            {
+                _kept = TextureHandle();
+                delete _cache;
+                delete _loader;
+                delete _shader;
+                GLState::deleteVertexArrays(1, &_vao);
+                GLState::deleteBuffers(1, &_vbo);
+            }
+
+            void setup() override
+            {
+                _shader = new Shader("shaders/sprite.vs", "shaders/sprite.fs");
+                _shader->use();
+                _vao = createQuad(_vbo);
+
+                _loader = new TextureLoader();
+                _cache = new TextureCache(*_loader);
+
+                // Same file, same sampler: one entry, one GL texture
+                TextureHandle plain = _cache->get("../textures/awesomeface.png");
+                TextureHandle dotted = _cache->get("./../textures/awesomeface.png");
+                TextureHandle roundabout = _cache->get("../textures/../textures/awesomeface.png");
+                benchCheck(plain.id() != 0 && plain.id() == dotted.id() && plain.id() == roundabout.id(),
+                           "spellings of one path share a texture");
+                benchCheck(_cache->size() == 1, "spellings of one path share an entry");
+
+                // Anything else about how it's sampled is its own texture
+                SamplerState clamped;
+                clamped.wrapS = clamped.wrapT = GL_CLAMP_TO_EDGE;
+                TextureHandle clamp = _cache->get("../textures/awesomeface.png", clamped);
+                TextureHandle unflipped = _cache->get("../textures/awesomeface.png", SamplerState(), false);
+                benchCheck(clamp.id() != plain.id() && unflipped.id() != plain.id() && unflipped.id() != clamp.id(),
+                           "other sampler state or flip gets its own texture");
+                benchCheck(_cache->size() == 3, "other sampler state or flip gets its own entry");
+
+                clamp.bind(0);
+                GLint wrap = 0;
+                glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, &wrap);
+                benchCheck(wrap == GL_CLAMP_TO_EDGE, "sampler state applied to the texture");
+
+                _loader->finish();
+                size_t resident = _cache->residentBytes();
+                benchCheck(resident > 0, "uploaded textures counted as resident");
+
+                // The GL texture goes with the last handle, not before
+                GLuint shared = plain.id();
+                TextureHandle copy = plain;
+                plain = TextureHandle();
+                dotted = TextureHandle();
+                roundabout = TextureHandle();
+                benchCheck(glIsTexture(shared) == GL_TRUE && _cache->size() == 3, "texture kept while a handle is left");
+                copy = TextureHandle();
+                benchCheck(glIsTexture(shared) == GL_FALSE, "texture deleted with the last handle");
+                benchCheck(_cache->size() == 2 && _cache->residentBytes() < resident,
+                           "entry and its memory gone with the last handle");
+
+                clamp = TextureHandle();
+                unflipped = TextureHandle();
+                benchCheck(_cache->size() == 0 && _cache->residentBytes() == 0, "cache empty once every handle is gone");
+
+                // Keeps the image loaded while frames look it up again
+                _kept = _cache->get("../textures/awesomeface.png");
+                _loader->finish();
+                _created = _cache->size();
+            }
+
+            void frame() override
+            {
+                _loader->pump();
+
+                glClear(GL_COLOR_BUFFER_BIT);
+                _shader->use();
+                GLState::bindVertexArray(_vao);
+
+                for (const char* path : { "../textures/awesomeface.png", "./../textures/awesomeface.png" })
+                {
+                    TextureHandle texture = _cache->get(path);
+                    texture.bind(0);
+                    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+                }
+                _created = std::max(_created, _cache->size());
+            }
+
+            void metrics(std::vector<BenchMetric> &out) const override
+            {
+                benchCheck(_created == 1, "lookups in the frame loop never create a texture");
+                out.push_back({ "textures_created", (double) _created, "count" });
+            }
+    };
+
+    bool registered = registerBench("texture_cache_budget", benchFactory<TextureCacheBudgetScenario>())
+        && registerBench("texture_cache_sharing", benchFactory<TextureCacheSharingScenario>());
+}
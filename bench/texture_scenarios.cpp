@@ -0,0 +1,254 @@
+#include "bench.hpp"
+#include "../wrappers/gl_state.hpp"
+#include "../wrappers/mipmap.hpp"
+#include "../wrappers/pixel_upload_ring.hpp"
+#include "../wrappers/texture_file.hpp"
+#include "../wrappers/texture_loader.hpp"
+#include "../wrappers/thread_pool.hpp"
+#include <glad/glad.h>
+#include <stb_image.h>
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+    // Drops a file's pages from the page cache, the closest we get to a
+    // cold start without root
+    void evictFromPageCache(const char* path)
+    {
+        int fd = open(path, O_RDONLY);
+        if (fd < 0)
+            return;
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+
+    // One texture through TextureLoader per frame, decoded with stb_image
+    // or mapped from a baked .txb, with the file cached or not
+    class TextureLoadScenario : public BenchScenario
+    {
+        bool _baked;
+        bool _cold;
+        std::string _path;
+        TextureLoader* _loader = nullptr;
+
+        public:
+            TextureLoadScenario(bool baked, bool cold) : _baked(baked), _cold(cold) {}
+            ~TextureLoadScenario() { delete _loader; }
+
+            int frames(int requested) const override { return std::min(requested, 30); }
+
+            void setup() override
+            {
+                _path = "../textures/container.jpg";
+                if (_baked)
+                {
+                    int width, height, channels;
+                    unsigned char* data = stbi_load(_path.c_str(), &width, &height, &channels, 0);
+                    _path = benchTempDirectory() + "/container.txb";
+                    TextureFile::write(_path.c_str(), buildMipChain(data, width, height, channels), channels);
+                    stbi_image_free(data);
+                }
+                _loader = new TextureLoader();
+            }
+
+            void frame() override
+            {
+                if (_cold)
+                    evictFromPageCache(_path.c_str());
+
+                GLuint texture = _loader->load(_path.c_str());
+                _loader->finish();
+                _loader->discard(texture);
+            }
+    };
+
+    void randomPixels(std::vector<unsigned char> &pixels, size_t count)
+    {
+        pixels.resize(count);
+        unsigned state = 12345;
+        for (unsigned char &value : pixels)
+        {
+            state = state * 1664525u + 1013904223u;
+            value = (unsigned char) (state >> 24);
+        }
+    }
+
+    bool sameLevels(const std::vector<MipLevel> &a, const std::vector<MipLevel> &b)
+    {
+        if (a.size() != b.size())
+            return false;
+        for (size_t i = 0; i < a.size(); i++)
+            if (a[i].width != b[i].width || a[i].height != b[i].height || a[i].pixels != b[i].pixels)
+                return false;
+        return true;
+    }
+
+    // Built again with the scalar reference, alone. The box kernels round
+    // exactly like it and the rest is the same code run on other rows, so
+    // the match is exact, not within a tolerance.
+    void checkAgainstScalar(const std::vector<unsigned char> &pixels, int width, int height, int channels,
+                            const MipOptions &options, const char* what)
+    {
+        MipOptions reference = options;
+        reference.simd = false;
+        reference.pool = nullptr;
+        benchCheck(sameLevels(buildMipLevels(pixels.data(), width, height, channels, options),
+                              buildMipLevels(pixels.data(), width, height, channels, reference)), what);
+    }
+
+    // Rounded average of a block of channel c, worked out on its own
+    int blockAverage(const unsigned char* pixels, int width, int channels, int x0, int x1, int y0, int y1, int c)
+    {
+        int sum = 0, count = (x1 - x0 + 1) * (y1 - y0 + 1);
+        for (int y = y0; y <= y1; y++)
+            for (int x = x0; x <= x1; x++)
+                sum += pixels[((size_t) y * width + x) * channels + c];
+        return (sum + count / 2) / count;
+    }
+
+    // CPU mip chain of a 2048x2048 RGBA image, scalar reference against the
+    // SIMD kernels, alone and split over a pool. Before timing, the SIMD
+    // variants check they build what the scalar reference does, here and on
+    // an odd-sized image in sRGB and with the Kaiser filter too.
+    class MipScenario : public BenchScenario
+    {
+        static const int size = 2048;
+        static const int oddWidth = 2047;
+        static const int oddHeight = 1023;
+
+        bool _simd;
+        bool _threaded;
+        std::vector<unsigned char> _pixels;
+        ThreadPool* _pool = nullptr;
+
+        public:
+            MipScenario(bool simd, bool threaded) : _simd(simd), _threaded(threaded) {}
+            ~MipScenario() { delete _pool; }
+
+            int frames(int requested) const override { return std::min(requested, 30); }
+
+            void setup() override
+            {
+                randomPixels(_pixels, (size_t) size * size * 4);
+                if (_threaded)
+                    _pool = new ThreadPool();
+                if (!_simd)
+                    return;
+
+                MipOptions options;
+                options.simd = true;
+                options.pool = _pool;
+                checkAgainstScalar(_pixels, size, size, 4, options, "mip levels match the scalar reference");
+
+                std::vector<unsigned char> odd;
+                randomPixels(odd, (size_t) oddWidth * oddHeight * 4);
+                checkAgainstScalar(odd, oddWidth, oddHeight, 4, options, "odd-sized RGBA mips match the scalar reference");
+                checkAgainstScalar(odd, oddWidth, oddHeight, 3, options, "odd-sized RGB mips match the scalar reference");
+
+                MipOptions srgb = options;
+                srgb.srgb = true;
+                checkAgainstScalar(odd, oddWidth, oddHeight, 4, srgb, "odd-sized sRGB mips match the scalar reference");
+
+                MipOptions kaiser = options;
+                kaiser.filter = MipFilter::Kaiser;
+                checkAgainstScalar(odd, oddWidth, oddHeight, 4, kaiser, "odd-sized Kaiser mips match the scalar reference");
+
+                // The last column and row of an odd level fold into the last
+                // texels: 3x3 in the corner, 2x3 along the bottom, 3x2 on the right
+                MipLevel first = buildMipLevels(odd.data(), oddWidth, oddHeight, 4, options)[0];
+                auto texel = [&](int x, int y, int c) { return (int) first.pixels[((size_t) y * first.width + x) * 4 + c]; };
+                int right = first.width - 1, bottom = first.height - 1;
+                bool folded = first.width == oddWidth / 2 && first.height == oddHeight / 2;
+                for (int c = 0; folded && c < 4; c++)
+                {
+                    folded = texel(right, bottom, c) == blockAverage(odd.data(), oddWidth, 4, oddWidth - 3, oddWidth - 1,
+                                                                     oddHeight - 3, oddHeight - 1, c)
+                          && texel(0, bottom, c) == blockAverage(odd.data(), oddWidth, 4, 0, 1,
+                                                                 oddHeight - 3, oddHeight - 1, c)
+                          && texel(right, 0, c) == blockAverage(odd.data(), oddWidth, 4, oddWidth - 3, oddWidth - 1,
+                                                                0, 1, c);
+                }
+                benchCheck(folded, "odd last row and column folded into the last texels");
+            }
+
+            void frame() override
+            {
+                MipOptions options;
+                options.simd = _simd;
+                options.pool = _pool;
+                buildMipLevels(_pixels.data(), size, size, 4, options);
+            }
+    };
+
+    // 1024x1024 RGBA uploads, staged through PixelUploadRing or straight
+    // from client memory
+    class UploadScenario : public BenchScenario
+    {
+        static const int size = 1024;
+        static const int uploadsPerFrame = 4;
+
+        bool _ring;
+        std::vector<unsigned char> _pixels;
+        GLuint _textures[uploadsPerFrame] = {};
+        PixelUploadRing* _uploads = nullptr;
+        double _seconds = 0.0;
+        unsigned long long _bytes = 0;
+
+        public:
+            explicit UploadScenario(bool ring) : _ring(ring) {}
+
+            ~UploadScenario()
+            {
+                GLState::deleteTextures(uploadsPerFrame, _textures);
+                delete _uploads;
+            }
+
+            void setup() override
+            {
+                _pixels.assign(size * size * 4, 128);
+                glGenTextures(uploadsPerFrame, _textures);
+                if (_ring)
+                    _uploads = new PixelUploadRing();
+            }
+
+            void frame() override
+            {
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < uploadsPerFrame; i++)
+                {
+                    GLState::bindTexture(GL_TEXTURE_2D, _textures[i]);
+                    if (_uploads)
+                        _uploads->texImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, GL_RGBA, GL_UNSIGNED_BYTE,
+                                             _pixels.data(), _pixels.size());
+                    else
+                        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                                     _pixels.data());
+                }
+
+                // Counted until the GPU has the pixels, not just until the
+                // calls return
+                glFinish();
+                _seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                _bytes += (unsigned long long) uploadsPerFrame * _pixels.size();
+            }
+
+            void metrics(std::vector<BenchMetric> &out) const override
+            {
+                out.push_back({ "throughput", _bytes / (1024.0 * 1024.0) / _seconds, "MB/s", false });
+            }
+    };
+
+    bool registered = registerBench("texture_load_jpg_warm", benchFactory<TextureLoadScenario>(false, false))
+        && registerBench("texture_load_jpg_cold", benchFactory<TextureLoadScenario>(false, true))
+        && registerBench("texture_load_txb_warm", benchFactory<TextureLoadScenario>(true, false))
+        && registerBench("texture_load_txb_cold", benchFactory<TextureLoadScenario>(true, true))
+        && registerBench("mip_scalar", benchFactory<MipScenario>(false, false))
+        && registerBench("mip_simd", benchFactory<MipScenario>(true, false))
+        && registerBench("mip_simd_threaded", benchFactory<MipScenario>(true, true))
+        && registerBench("upload_direct", benchFactory<UploadScenario>(false))
+        && registerBench("upload_ring", benchFactory<UploadScenario>(true));
+}
@@ -0,0 +1,131 @@
+#include "bench.hpp"
+#include "../wrappers/gl_state.hpp"
+#include "../wrappers/shader.hpp"
+#include "../wrappers/uniform_block.hpp"
+#include <glad/glad.h>
+#include <cmath>
+
+// Per-frame data (a matrix, the viewport and the time) needed by every
+// program in the scene: pushed into each program with glUniform*, or
+// written once into a UniformBlock that all of them read.
+
+namespace
+{
+    const int programCount = 32;
+
+    struct FrameData
+    {
+        std140::mat4 viewProjection;
+        std140::vec2 viewport;
+        float time;
+    };
+    STD140_MEMBER(FrameData, viewProjection, 0);
+    STD140_MEMBER(FrameData, viewport, 64);
+    STD140_MEMBER(FrameData, time, 72);
+
+    class FrameDataScenario : public BenchScenario
+    {
+        struct Program
+        {
+            Shader* shader;
+            UniformHandle viewProjection;
+            UniformHandle viewport;
+            UniformHandle time;
+        };
+
+        bool _block;
+        std::vector<Program> _programs;
+        UniformBlock<FrameData>* _frameBlock = nullptr;
+        GLuint _vao = 0;
+        GLuint _vbo = 0;
+        int _frame = 0;
+
+        public:
+            explicit FrameDataScenario(bool block) : _block(block) {}
+
+            ~FrameDataScenario()
+            {
+                GLState::deleteVertexArrays(1, &_vao);
+                GLState::deleteBuffers(1, &_vbo);
+                for (Program &program : _programs)
+                    delete program.shader;
+                delete _frameBlock;
+            }
+
+            void setup() override
+            {
+                const char* vertexPath = _block ? "shaders/frame_block.vs" : "shaders/frame_uniforms.vs";
+                if (_block)
+                    _frameBlock = new UniformBlock<FrameData>(0);
+
+                for (int i = 0; i < programCount; i++)
+                {
+                    Program program;
+                    program.shader = new Shader(vertexPath, "../shaders/fragShader1.glsl");
+                    program.viewProjection = program.shader->uniform("viewProjection"_u);
+                    program.viewport = program.shader->uniform("viewport"_u);
+                    program.time = program.shader->uniform("time"_u);
+                    if (_frameBlock)
+                        _frameBlock->attach(*program.shader, "FrameData");
+                    _programs.push_back(program);
+                }
+
+                float vertices[] = {
+                    0.5f, -0.5f, 0.0f,  1.0f, 0.0f, 0.0f,
+                    -0.5f, -0.5f, 0.0f,  0.0f, 1.0f, 0.0f,
+                    0.0f,  0.5f, 0.0f,  0.0f, 0.0f, 1.0f
+                };
+
+                glGenVertexArrays(1, &_vao);
+                glGenBuffers(1, &_vbo);
+                GLState::bindVertexArray(_vao);
+                GLState::bindBuffer(GL_ARRAY_BUFFER, _vbo);
+                glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+                glEnableVertexAttribArray(0);
+                glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+                glEnableVertexAttribArray(1);
+            }
+
+            void frame() override
+            {
+                FrameData data = {};
+                float scale = 0.5f + 0.25f * std::sin(_frame * 0.1f);
+                data.viewProjection.columns[0] = { scale, 0.0f, 0.0f, 0.0f };
+                data.viewProjection.columns[1] = { 0.0f, scale, 0.0f, 0.0f };
+                data.viewProjection.columns[2] = { 0.0f, 0.0f, 1.0f, 0.0f };
+                data.viewProjection.columns[3] = { 0.0f, 0.0f, 0.0f, 1.0f };
+                data.viewport = { 800.0f, 600.0f };
+                data.time = _frame * 0.016f;
+                _frame++;
+
+                glClear(GL_COLOR_BUFFER_BIT);
+
+                if (_frameBlock)
+                    _frameBlock->update(data);
+
+                GLState::bindVertexArray(_vao);
+                for (Program &program : _programs)
+                {
+                    program.shader->use();
+                    if (!_frameBlock)
+                    {
+                        glUniformMatrix4fv(program.viewProjection.location, 1, GL_FALSE, &data.viewProjection.columns[0].x);
+                        glUniform2f(program.viewport.location, data.viewport.x, data.viewport.y);
+                        glUniform1f(program.time.location, data.time);
+                    }
+                    glDrawArrays(GL_TRIANGLES, 0, 3);
+                }
+            }
+
+            void metrics(std::vector<BenchMetric> &out) const override
+            {
+                out.push_back({ "uniform_calls_per_frame", _frameBlock ? 0.0 : programCount * 3.0, "calls" });
+                if (_frameBlock)
+                    out.push_back({ "ring_stalls", (double) _frameBlock->stats().stalls, "stalls" });
+            }
+    };
+
+    bool registered = registerBench("frame_data_uniforms", benchFactory<FrameDataScenario>(false))
+        && registerBench("frame_data_block", benchFactory<FrameDataScenario>(true));
+}
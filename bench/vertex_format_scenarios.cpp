@@ -0,0 +1,145 @@
+#include "bench.hpp"
+#include "../wrappers/gl_state.hpp"
+#include "../wrappers/shader.hpp"
+#include "../wrappers/vertex_layout.hpp"
+#include <glad/glad.h>
+#include <cmath>
+#include <vector>
+
+// A finely tessellated, lit grid drawn a few times a frame, so vertex
+// fetch is a real part of the work. The same mesh is stored as plain
+// floats (48 bytes a vertex) or packed (24 bytes): half float texture
+// coords, 2_10_10_10 normals and unorm8 colors.
+
+namespace
+{
+    const int gridSize = 256; // quads per side
+    const int drawsPerFrame = 8;
+
+    struct FloatVertex
+    {
+        vertex::vec3 position;
+        vertex::vec3 normal;
+        vertex::vec2 texCoord;
+        vertex::vec4 color;
+    };
+    typedef VertexLayout<vertex::vec3, vertex::vec3, vertex::vec2, vertex::vec4> FloatLayout;
+    VERTEX_ATTRIBUTE(FloatLayout, FloatVertex, 0, position);
+    VERTEX_ATTRIBUTE(FloatLayout, FloatVertex, 1, normal);
+    VERTEX_ATTRIBUTE(FloatLayout, FloatVertex, 2, texCoord);
+    VERTEX_ATTRIBUTE(FloatLayout, FloatVertex, 3, color);
+
+    struct PackedVertex
+    {
+        vertex::vec3 position;
+        vertex::snorm10x3 normal;
+        vertex::half2 texCoord;
+        vertex::unorm8x4 color;
+    };
+    typedef VertexLayout<vertex::vec3, vertex::snorm10x3, vertex::half2, vertex::unorm8x4> PackedLayout;
+    VERTEX_ATTRIBUTE(PackedLayout, PackedVertex, 0, position);
+    VERTEX_ATTRIBUTE(PackedLayout, PackedVertex, 1, normal);
+    VERTEX_ATTRIBUTE(PackedLayout, PackedVertex, 2, texCoord);
+    VERTEX_ATTRIBUTE(PackedLayout, PackedVertex, 3, color);
+
+    class VertexFormatScenario : public BenchScenario
+    {
+        bool _packed;
+        Shader* _shader = nullptr;
+        GLuint _vao = 0;
+        GLuint _vbo = 0;
+        GLuint _ebo = 0;
+        GLsizei _indexCount = 0;
+        size_t _vertexBytes = 0;
+
+        public:
+            explicit VertexFormatScenario(bool packed) : _packed(packed) {}
+
+            ~VertexFormatScenario()
+            {
+                GLState::deleteVertexArrays(1, &_vao);
+                GLState::deleteBuffers(1, &_vbo);
+                GLState::deleteBuffers(1, &_ebo);
+                delete _shader;
+            }
+
+            void setup() override
+            {
+                _shader = new Shader("shaders/lit_vertex.vs", "shaders/lit_vertex.fs");
+
+                std::vector<FloatVertex> floats;
+                std::vector<PackedVertex> packed;
+                for (int y = 0; y <= gridSize; y++)
+                {
+                    for (int x = 0; x <= gridSize; x++)
+                    {
+                        float u = (float) x / gridSize, v = (float) y / gridSize;
+
+                        // A gentle bump, so the normals vary
+                        float nx = 0.5f * std::sin(u * 6.2831853f), ny = 0.5f * std::cos(v * 6.2831853f);
+                        float length = std::sqrt(nx * nx + ny * ny + 1.0f);
+
+                        FloatVertex vertex = {
+                            { u * 2.0f - 1.0f, v * 2.0f - 1.0f, 0.0f },
+                            { nx / length, ny / length, 1.0f / length },
+                            { u, v },
+                            { u, v, 1.0f - u, 1.0f }
+                        };
+                        floats.push_back(vertex);
+                        packed.push_back({
+                            vertex.position,
+                            vertex::packSnorm10x3(vertex.normal.x, vertex.normal.y, vertex.normal.z),
+                            vertex::packHalf2(u, v),
+                            vertex::packUnorm8x4(vertex.color.x, vertex.color.y, vertex.color.z, vertex.color.w)
+                        });
+                    }
+                }
+
+                std::vector<GLuint> indices;
+                for (int y = 0; y < gridSize; y++)
+                {
+                    for (int x = 0; x < gridSize; x++)
+                    {
+                        GLuint corner = y * (gridSize + 1) + x;
+                        GLuint above = corner + gridSize + 1;
+                        indices.insert(indices.end(), { corner, corner + 1, above, corner + 1, above + 1, above });
+                    }
+                }
+                _indexCount = (GLsizei) indices.size();
+
+                glGenBuffers(1, &_vbo);
+                glGenBuffers(1, &_ebo);
+                if (_packed)
+                {
+                    _vao = PackedLayout::createVertexArray(_vbo, _ebo);
+                    _vertexBytes = packed.size() * sizeof(PackedVertex);
+                    glBufferData(GL_ARRAY_BUFFER, _vertexBytes, packed.data(), GL_STATIC_DRAW);
+                }
+                else
+                {
+                    _vao = FloatLayout::createVertexArray(_vbo, _ebo);
+                    _vertexBytes = floats.size() * sizeof(FloatVertex);
+                    glBufferData(GL_ARRAY_BUFFER, _vertexBytes, floats.data(), GL_STATIC_DRAW);
+                }
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+            }
+
+            void frame() override
+            {
+                glClear(GL_COLOR_BUFFER_BIT);
+                _shader->use();
+                GLState::bindVertexArray(_vao);
+                for (int i = 0; i < drawsPerFrame; i++)
+                    glDrawElements(GL_TRIANGLES, _indexCount, GL_UNSIGNED_INT, 0);
+            }
+
+            void metrics(std::vector<BenchMetric> &out) const override
+            {
+                out.push_back({ "bytes_per_vertex", (double) (_packed ? PackedLayout::stride : FloatLayout::stride), "bytes" });
+                out.push_back({ "vertex_buffer_kb", _vertexBytes / 1024.0, "KB" });
+            }
+    };
+
+    bool registered = registerBench("vertex_format_float", benchFactory<VertexFormatScenario>(false))
+        && registerBench("vertex_format_packed", benchFactory<VertexFormatScenario>(true));
+}
@@ -1,6 +1,7 @@
 #include <iostream>
 #include <glad/glad.h> // GLAD comes first!
 #include <GLFW/glfw3.h>
+#include "../wrappers/app_context.hpp"
 
 void framebuffer_resize_callback(GLFWwindow* window, int w, int h);
 void processInput(GLFWwindow* window);
@@ -20,30 +21,15 @@ const char *fragmentShaderSource = "#version 330 core\n"
     "}\0";
 
 
-int main()
+int main(int argc, char** argv)
 {
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-    GLFWwindow* window = glfwCreateWindow(800, 600, "Hello Triangle!", NULL, NULL);
-    if (window == NULL)
-    {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
+    AppContext app { 800, 600, "Hello Triangle!", argc, argv };
+    if (!app.valid())
         return -1;
-    }
-    glfwMakeContextCurrent(window);
-
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
-    {
-        std::cout << "Failed to initialize GLAD" << std::endl;
-        return -1;
-    }
 
     glViewport(0, 0, 800, 600);
-    glfwSetFramebufferSizeCallback(window, framebuffer_resize_callback);
+    if (app.window())
+        glfwSetFramebufferSizeCallback(app.window(), framebuffer_resize_callback);
 
     /*
     ** ============== SHADERS =============
@@ -153,9 +139,10 @@ int main()
    // Unbinding the VAO isn't always necessary since binding another would already unbind this one.
    glBindVertexArray(0);
 
-    while(!glfwWindowShouldClose(window))
+    while(!app.shouldClose())
     {
-        processInput(window);
+        if (app.window())
+            processInput(app.window());
 
         // Rendering stuff here
         glClearColor(0.0f, 0.05f, 0.3f, 1.0f);
@@ -165,11 +152,9 @@ int main()
         glBindVertexArray(VAO);
         glDrawArrays(GL_TRIANGLES, 0, 3);
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        app.endFrame();
     }
 
-    glfwTerminate();
     return 0;
 }
 
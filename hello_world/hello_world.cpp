@@ -1,53 +1,36 @@
 #include <iostream>
 #include <glad/glad.h> // GLAD comes first!
 #include <GLFW/glfw3.h>
+#include "../wrappers/app_context.hpp"
 
 void framebuffer_resize_callback(GLFWwindow* window, int w, int h);
 void processInput(GLFWwindow* window);
 
-int main()
+int main(int argc, char** argv)
 {
-    // Init GLFW and window parameters
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-    // Create window
-    GLFWwindow* window = glfwCreateWindow(800, 600, "Hello World!", NULL, NULL);
-    if (window == NULL)
-    {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
-    }
-    glfwMakeContextCurrent(window);
-
-    // Load GLAD
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
-    {
-        std::cout << "Failed to initialize GLAD" << std::endl;
+    // Window and GL context (or an offscreen one, with --headless), GLAD included
+    AppContext app { 800, 600, "Hello World!", argc, argv };
+    if (!app.valid())
         return -1;
-    }
 
     // Create viewport (actual rendering window size) and set resize callbak
     glViewport(0, 0, 800, 600);
-    glfwSetFramebufferSizeCallback(window, framebuffer_resize_callback);
+    if (app.window())
+        glfwSetFramebufferSizeCallback(app.window(), framebuffer_resize_callback);
 
     // Render Loop
-    while(!glfwWindowShouldClose(window))
+    while(!app.shouldClose())
     {
-        processInput(window);
+        if (app.window())
+            processInput(app.window());
 
         // Rendering stuff here
         glClearColor(0.0f, 0.1f, 0.8f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        app.endFrame();
     }
 
-    glfwTerminate();
     return 0;
 }
 
@@ -1,81 +1,107 @@
+#include "../wrappers/app_context.hpp"
 #include "../wrappers/shader.hpp"
+#include "../wrappers/gl_state.hpp"
+#include "../wrappers/program_cache.hpp"
+#include "../wrappers/shader_reloader.hpp"
+#include "../wrappers/frame_profiler.hpp"
+#include "../wrappers/vertex_layout.hpp"
 #include <iostream>
 #include <cmath>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+// 16 bytes a vertex, the colors are exact in 8 bits
+struct ColoredVertex
+{
+    vertex::vec3 position;
+    vertex::unorm8x4 color;
+};
+typedef VertexLayout<vertex::vec3, vertex::unorm8x4> ColoredLayout;
+VERTEX_ATTRIBUTE(ColoredLayout, ColoredVertex, 0, position);
+VERTEX_ATTRIBUTE(ColoredLayout, ColoredVertex, 1, color);
+
 void framebuffer_resize_callback(GLFWwindow* window, int w, int h);
 void processInput(GLFWwindow* window);
 
-int main()
+int main(int argc, char** argv)
 {
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-    GLFWwindow* window = glfwCreateWindow(800, 600, "Hello Triangle!", NULL, NULL);
-    if (window == NULL)
-    {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
+    AppContext app { 800, 600, "Hello Triangle!", argc, argv };
+    if (!app.valid())
         return -1;
-    }
-    glfwMakeContextCurrent(window);
-
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
-    {
-        std::cout << "Failed to initialize GLAD" << std::endl;
-        return -1;
-    }
 
     glViewport(0, 0, 800, 600);
-    glfwSetFramebufferSizeCallback(window, framebuffer_resize_callback);
+    if (app.window())
+        glfwSetFramebufferSizeCallback(app.window(), framebuffer_resize_callback);
 
     Shader shader { "vertexShader1.glsl", "fragShader1.glsl" };
 
-    float vertices[] = {
-        // positions         // colors
-        0.5f, -0.5f, 0.0f,  1.0f, 0.0f, 0.0f,   // bottom right
-        -0.5f, -0.5f, 0.0f,  0.0f, 1.0f, 0.0f,   // bottom left
-        0.0f,  0.5f, 0.0f,  0.0f, 0.0f, 1.0f    // top
+    const ProgramCache::Stats &cacheStats = ProgramCache::stats();
+    std::cout << "Program cache: " << cacheStats.hits << " hit(s), "
+              << cacheStats.misses << " miss(es)" << std::endl;
+
+    ColoredVertex vertices[] = {
+        // positions               // colors
+        { { 0.5f, -0.5f, 0.0f },   vertex::packUnorm8x4(1.0f, 0.0f, 0.0f) },   // bottom right
+        { { -0.5f, -0.5f, 0.0f },  vertex::packUnorm8x4(0.0f, 1.0f, 0.0f) },   // bottom left
+        { { 0.0f,  0.5f, 0.0f },   vertex::packUnorm8x4(0.0f, 0.0f, 1.0f) }    // top
     };
 
-    GLuint VAO, VBO;
-    glGenVertexArrays(1, &VAO);
+    GLuint VBO;
     glGenBuffers(1, &VBO);
 
-    glBindVertexArray(VAO);
+    GLuint VAO = ColoredLayout::createVertexArray(VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    shader.setUniform("offset"_u, 0.0f);
+    UniformHandle offsetUniform = shader.uniform("offset"_u);
 
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+    // Edit the .glsl files while this runs to see them swapped in
+    ShaderReloader reloader { app };
+    reloader.watch(shader, [&](Shader &reloaded) { offsetUniform = reloaded.uniform("offset"_u); });
 
-    shader.setUniform("offset", 0.0f);
+    FrameProfiler profiler;
 
-    while(!glfwWindowShouldClose(window))
+    // Count only what the render loop does, not the setup above
+    GLState::resetStats();
+    unsigned frames = 0;
+
+    while(!app.shouldClose())
     {
-        processInput(window);
+        profiler.beginFrame();
+
+        if (app.window())
+            processInput(app.window());
+
+        reloader.update();
 
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        shader.use();
+        {
+            FrameProfiler::Zone zone { profiler, "draw" };
+            shader.use();
+
+            shader.setUniform(offsetUniform, (float) (sin(app.time()) * 0.5));
 
-        shader.setUniform("offset", (float) (sin(glfwGetTime()) * 0.5));
+            GLState::bindVertexArray(VAO);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
 
-        glBindVertexArray(VAO);
-        glDrawArrays(GL_TRIANGLES, 0, 3);
+        profiler.endFrame();
+        frames++;
+        app.endFrame();
+    }
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+    std::cout << profiler.summary();
+    if (frames > 0)
+    {
+        const GLState::Stats &glStats = GLState::stats();
+        std::cout << "GL state calls per frame: " << (double) glStats.issued / frames << " issued, "
+                  << (double) glStats.elided / frames << " elided" << std::endl;
     }
+    if (!app.tracePath().empty())
+        profiler.writeTrace(app.tracePath().c_str());
 
-    glfwTerminate();
     return 0;
 }
 
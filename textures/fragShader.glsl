@@ -1,17 +1,22 @@
 #version 330 core
+#include "texture_layers.glsl"
+
 out vec4 FragColor;
 
 in vec3 ourColor;
 in vec2 TexCoord;
+flat in ivec2 Layers; // array layer of the first and second image
 
-uniform sampler2D texture1;
-uniform sampler2D texture2;
+uniform sampler2DArray textures;
 uniform int mult_amount;
 uniform float mix_amount;
 
 void main()
 {
-    vec2 newCoord = vec2(1 - TexCoord.x, TexCoord.y); // Exercise 1
+    vec2 newCoord = TexCoord;
+#ifdef FLIP_FACE
+    newCoord.x = 1 - newCoord.x; // Exercise 1, compiled in or out per variant
+#endif
     newCoord *= mult_amount;
-    FragColor = mix(texture(texture1, TexCoord), texture(texture2, newCoord), mix_amount);
+    FragColor = mix(sampleLayer(textures, TexCoord, Layers.x), sampleLayer(textures, newCoord, Layers.y), mix_amount);
 }
@@ -0,0 +1,5 @@
+// Reads one image out of a texture array, by layer index
+vec4 sampleLayer(sampler2DArray images, vec2 uv, int layer)
+{
+    return texture(images, vec3(uv, layer));
+}
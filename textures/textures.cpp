@@ -1,47 +1,89 @@
+#include "../wrappers/app_context.hpp"
 #include "../wrappers/shader.hpp"
+#include "../wrappers/gl_state.hpp"
+#include "../wrappers/program_cache.hpp"
+#include "../wrappers/shader_reloader.hpp"
+#include "../wrappers/shader_variants.hpp"
+#include "../wrappers/frame_profiler.hpp"
+#include "../wrappers/texture_array.hpp"
+#include "../wrappers/thread_pool.hpp"
+#include "../wrappers/vertex_layout.hpp"
 #include <iostream>
 #include <cmath>
+#include <filesystem>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
-#include <stb_image.h>
 
-void framebuffer_resize_callback(GLFWwindow* window, int w, int h);
-void processInput(GLFWwindow* window, float *mix, int *mult);
-
-int main()
+// Colors are exactly 0 or 1 and texture coords and layers small whole
+// numbers, so packing them loses nothing: 24 bytes a vertex instead of
+// the 40 it takes as floats
+struct QuadVertex
 {
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    vertex::vec3 position;
+    vertex::unorm8x4 color;
+    vertex::half2 texCoord;
+    vertex::half2 layers;
+};
+typedef VertexLayout<vertex::vec3, vertex::unorm8x4, vertex::half2, vertex::half2> QuadLayout;
+VERTEX_ATTRIBUTE(QuadLayout, QuadVertex, 0, position);
+VERTEX_ATTRIBUTE(QuadLayout, QuadVertex, 1, color);
+VERTEX_ATTRIBUTE(QuadLayout, QuadVertex, 2, texCoord);
+VERTEX_ATTRIBUTE(QuadLayout, QuadVertex, 3, layers);
 
-    GLFWwindow* window = glfwCreateWindow(800, 600, "Textures", NULL, NULL);
-    if (window == NULL)
-    {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
-    }
-    glfwMakeContextCurrent(window);
+void framebuffer_resize_callback(GLFWwindow* window, int w, int h);
+void processInput(GLFWwindow* window, float *mix, int *mult, bool *flip);
+const char* pickTexture(const char* baked, const char* source);
 
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
-    {
-        std::cout << "Failed to initialize GLAD" << std::endl;
+int main(int argc, char** argv)
+{
+    AppContext app { 800, 600, "Textures", argc, argv };
+    if (!app.valid())
         return -1;
-    }
 
     glViewport(0, 0, 800, 600);
-    glfwSetFramebufferSizeCallback(window, framebuffer_resize_callback);
+    if (app.window())
+        glfwSetFramebufferSizeCallback(app.window(), framebuffer_resize_callback);
+
+    // Exercise 1's flipped face is a compile-time variant of the fragment
+    // shader rather than a uniform. Both are built up front, F switches.
+    ShaderVariants variants { "vertexShader.glsl", "fragShader.glsl" };
+    Shader* flipped = &variants.get({ "FLIP_FACE" });
+    Shader* straight = &variants.get({});
+
+    const ProgramCache::Stats &cacheStats = ProgramCache::stats();
+    std::cout << "Program cache: " << cacheStats.hits << " hit(s), "
+              << cacheStats.misses << " miss(es)" << std::endl;
+
+    // ==============
+    // LOADING IMAGES
+    // ==============
 
-    Shader shader { "vertexShader.glsl", "fragShader.glsl" };
+    // Both images are the same size, so they become two layers of one
+    // texture array: a single bind covers both, and the shader picks the
+    // layer. Decoding and mipmapping run on the pool while the first frames
+    // draw with a white placeholder array, which is swapped for the real
+    // one once everything is decoded, so no frame waits on stb_image.
+    ThreadPool pool;
+    TextureArrayBuilder builder;
+    size_t container = builder.add(pickTexture("container.txb", "container.jpg"));
+    size_t face = builder.add(pickTexture("awesomeface.txb", "awesomeface.png"));
+    builder.start(pool);
+
+    TextureArray placeholder = builder.placeholder();
+    std::vector<TextureArray> arrays;
+    bool loading = true;
+
+    // Layers go in as a vertex attribute, like a per-sprite layer would.
+    // In the placeholder, image i is layer i.
+    vertex::half2 layers = vertex::packHalf2((float) container, (float) face);
 
     // Vertices using EBO (so we need to specify the indices)
-    float vertices[] = {
-        // positions          // colors           // texture coords
-        0.5f,  0.5f, 0.0f,   1.0f, 0.0f, 0.0f,   1.0f, 1.0f,   // top right
-        0.5f, -0.5f, 0.0f,   0.0f, 1.0f, 0.0f,   1.0f, 0.0f,   // bottom right
-        -0.5f, -0.5f, 0.0f,   0.0f, 0.0f, 1.0f,   0.0f, 0.0f,   // bottom left
-        -0.5f,  0.5f, 0.0f,   1.0f, 1.0f, 0.0f,   0.0f, 1.0f    // top left
+    QuadVertex vertices[] = {
+        // positions             // colors                                 // texture coords              // layers
+        { { 0.5f,  0.5f, 0.0f },  vertex::packUnorm8x4(1.0f, 0.0f, 0.0f),  vertex::packHalf2(1.0f, 1.0f),  layers },   // top right
+        { { 0.5f, -0.5f, 0.0f },  vertex::packUnorm8x4(0.0f, 1.0f, 0.0f),  vertex::packHalf2(1.0f, 0.0f),  layers },   // bottom right
+        { { -0.5f, -0.5f, 0.0f }, vertex::packUnorm8x4(0.0f, 0.0f, 1.0f),  vertex::packHalf2(0.0f, 0.0f),  layers },   // bottom left
+        { { -0.5f,  0.5f, 0.0f }, vertex::packUnorm8x4(1.0f, 1.0f, 0.0f),  vertex::packHalf2(0.0f, 1.0f),  layers }    // top left
     };
 
     unsigned int indices[] = {
@@ -49,130 +91,121 @@ int main()
         1, 2, 3  // second triangle
     };
 
-    GLuint VAO, VBO, EBO;
-    glGenVertexArrays(1, &VAO);
+    GLuint VBO, EBO;
     glGenBuffers(1, &VBO);
     glGenBuffers(1, &EBO);
 
-    glBindVertexArray(VAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    // Binds all three and sets up every attribute from QuadLayout, no
+    // strides or offsets to keep in sync by hand
+    GLuint VAO = QuadLayout::createVertexArray(VBO, EBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
-    // Note that we now have another vertex attribute, so we have to consider it in the stride
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-    // ==============
-    // LOADING IMAGES
-    // ==============
-
-    // Images are normally top-down ((0,0) at the top left of the screen),
-    // while OpenGL expects (0,0) to be at the bottom left. So we flip the image.
-    stbi_set_flip_vertically_on_load(true);
-
-    // Generating the OpenGL texture
-    GLuint textures[2];
-    glGenTextures(2, textures);
-
-    // Just like other objects, we bind them so that we can modify them.
-    // In this case, we bind it to the GL_TEXTURE_2D slot.
-    glBindTexture(GL_TEXTURE_2D, textures[0]);
-
-    // Adjust parameters like wrapping and filtering
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    // Using stb_image to load the jpg.
-    int width, height, nChannels;
-    unsigned char *data = stbi_load("container.jpg", &width, &height, &nChannels, 0);
+    int mult = 1.0;
+    float mix = 1.0f;
+    bool flip = true;
 
-    if (data)
-    {
-        // This pumps the image data into the GPU.
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
-    else
+    // Edit the .glsl files (includes too) while this runs and the programs
+    // are swapped between frames. A new program starts from scratch.
+    ShaderReloader reloader { app };
+    for (Shader* variant : { flipped, straight })
     {
-        std::cerr << "Failed to load texture!" << std::endl;
+        variant->use();
+        variant->setUniform("textures"_u, 0);
+        reloader.watch(*variant, [](Shader &reloaded)
+        {
+            reloaded.use();
+            reloaded.setUniform("textures"_u, 0);
+        });
     }
 
-    // We can free it now, since we loaded the data.
-    stbi_image_free(data);
-
-    // Now for the second texture.
-    glBindTexture(GL_TEXTURE_2D, textures[1]);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    data = stbi_load("awesomeface.png", &width, &height, &nChannels, 0);
-
-    if (data)
-    {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
-    else
-    {
-        std::cerr << "Failed to load texture!" << std::endl;
-    }
-    stbi_image_free(data);
+    // Nothing else ever binds a texture, so this holds until the real
+    // array is swapped in
+    GLState::activeTexture(GL_TEXTURE0);
+    GLState::bindTexture(GL_TEXTURE_2D_ARRAY, placeholder.texture);
 
-    int mult = 1.0;
-    float mix = 1.0f;
+    FrameProfiler profiler;
 
-    shader.use();
-    shader.setUniform("texture1", 0);
-    shader.setUniform("texture2", 1);
-    shader.setUniform("mult_amount", mult);
-    shader.setUniform("mix_amount", mix);
+    // Count only what the render loop does, not the setup above
+    GLState::resetStats();
+    unsigned frames = 0;
 
-    while(!glfwWindowShouldClose(window))
+    while(!app.shouldClose())
     {
-        processInput(window, &mix, &mult);
+        profiler.beginFrame();
+
+        if (app.window())
+            processInput(app.window(), &mix, &mult, &flip);
+
+        reloader.update();
+
+        // Swap the real array in once it's decoded. The upload itself is
+        // all that's left for this thread to do.
+        if (loading && builder.ready())
+        {
+            FrameProfiler::Zone zone { profiler, "upload" };
+            loading = false;
+            arrays = builder.build();
+
+            TextureArraySlot containerSlot = builder.slot(container);
+            TextureArraySlot faceSlot = builder.slot(face);
+            if (containerSlot.array < 0 || containerSlot.array != faceSlot.array)
+                std::cout << "ERROR::TEXTURES::IMAGES_NOT_IN_ONE_ARRAY" << std::endl; // keep the placeholder
+            else
+            {
+                layers = vertex::packHalf2((float) containerSlot.layer, (float) faceSlot.layer);
+                for (QuadVertex &vertex : vertices)
+                    vertex.layers = layers;
+                GLState::bindBuffer(GL_ARRAY_BUFFER, VBO);
+                glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
+
+                GLState::activeTexture(GL_TEXTURE0);
+                GLState::bindTexture(GL_TEXTURE_2D_ARRAY, arrays[containerSlot.array].texture);
+                GLState::deleteTextures(1, &placeholder.texture);
+                placeholder.texture = 0;
+            }
+        }
 
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        // Select the texture unit first.
-        // This tells OpenGL where each texture goes, allowing us to bind multiple textures in multiple slots.
-        // Each unit ID is adjacent, so we can do stuff like GL_TEXTURE0 + 1
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textures[0]);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, textures[1]);
+        {
+            FrameProfiler::Zone zone { profiler, "draw" };
+
+            // Drawing 6 indices aka elements
+            Shader &shader = flip ? *flipped : *straight;
+            shader.use();
 
-        // Drawing 6 indices aka elements
-        shader.use();
+            shader.setUniform("mult_amount"_u, mult);
+            shader.setUniform("mix_amount"_u, mix);
 
-        shader.setUniform("mult_amount", mult);
-        shader.setUniform("mix_amount", mix);
+            GLState::bindVertexArray(VAO);
+            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        }
 
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        profiler.endFrame();
+        frames++;
+        app.endFrame();
+    }
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+    std::cout << profiler.summary();
+    if (frames > 0)
+    {
+        const GLState::Stats &glStats = GLState::stats();
+        std::cout << "GL state calls per frame: " << (double) glStats.issued / frames << " issued, "
+                  << (double) glStats.elided / frames << " elided" << std::endl;
     }
+    if (!app.tracePath().empty())
+        profiler.writeTrace(app.tracePath().c_str());
+
+    GLState::deleteVertexArrays(1, &VAO);
+    GLState::deleteBuffers(1, &VBO);
+    GLState::deleteBuffers(1, &EBO);
 
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
+    GLState::deleteTextures(1, &placeholder.texture);
+    for (const TextureArray &array : arrays)
+        GLState::deleteTextures(1, &array.texture);
 
-    glfwTerminate();
     return 0;
 }
 
@@ -181,7 +214,13 @@ void framebuffer_resize_callback(GLFWwindow* window, int w, int h)
     glViewport(0, 0, w, h);
 }
 
-void processInput(GLFWwindow* window, float *mix, int *mult)
+// Prefer the texture baked by `make bake`, when there is one
+const char* pickTexture(const char* baked, const char* source)
+{
+    return std::filesystem::exists(baked) ? baked : source;
+}
+
+void processInput(GLFWwindow* window, float *mix, int *mult, bool *flip)
 {
     if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
@@ -210,4 +249,11 @@ void processInput(GLFWwindow* window, float *mix, int *mult)
         if (*mult < 1)
             *mult = 1;
     }
+
+    // Once per press, not every frame the key is held
+    static bool flipHeld = false;
+    bool flipDown = glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS;
+    if (flipDown && !flipHeld)
+        *flip = !*flip;
+    flipHeld = flipDown;
 }
@@ -2,13 +2,16 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aColor;
 layout (location = 2) in vec2 aTexCoord;
+layout (location = 3) in vec2 aLayers;
 
 out vec3 ourColor;
 out vec2 TexCoord;
+flat out ivec2 Layers;
 
 void main()
 {
     gl_Position = vec4(aPos, 1.0);
     ourColor = aColor;
     TexCoord = aTexCoord;
+    Layers = ivec2(aLayers);
 }
@@ -0,0 +1,89 @@
+// Offline atlas baker: packs images into atlas pages and writes them as
+// .txb files plus a region list that TextureAtlas::load() reads back.
+//
+//     atlasbake [--no-flip] [--size N] [--padding N] output_prefix images...
+//
+// Writes output_prefix_0.txb, output_prefix_1.txb, ... and
+// output_prefix.atlas. Regions are named after the image paths as given.
+
+#include "../wrappers/texture_atlas.hpp"
+#include <stb_image.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+struct Image
+{
+    const char* path;
+    int width;
+    int height;
+    int channels;
+    unsigned char* data;
+};
+
+int main(int argc, char** argv)
+{
+    bool flip = true;
+    int pageSize = 2048;
+    int padding = 1;
+
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if (std::strcmp(argv[arg], "--no-flip") == 0)
+            flip = false;
+        else if (std::strcmp(argv[arg], "--size") == 0 && arg + 1 < argc)
+            pageSize = std::atoi(argv[++arg]);
+        else if (std::strcmp(argv[arg], "--padding") == 0 && arg + 1 < argc)
+            padding = std::atoi(argv[++arg]);
+        else
+            break;
+    }
+
+    if (argc - arg < 2 || pageSize <= 0 || padding < 0)
+    {
+        std::cerr << "Usage: atlasbake [--no-flip] [--size N] [--padding N] output_prefix images..." << std::endl;
+        return 1;
+    }
+
+    const char* prefix = argv[arg++];
+
+    stbi_set_flip_vertically_on_load(flip);
+
+    std::vector<Image> images;
+    for (; arg < argc; arg++)
+    {
+        Image image { argv[arg], 0, 0, 0, nullptr };
+        image.data = stbi_load(image.path, &image.width, &image.height, &image.channels, 0);
+        if (!image.data)
+        {
+            std::cerr << "Failed to load " << image.path << ": " << stbi_failure_reason() << std::endl;
+            return 1;
+        }
+        images.push_back(image);
+    }
+
+    // Offline we can afford to sort: tallest first packs tightest
+    std::stable_sort(images.begin(), images.end(), [] (const Image &a, const Image &b) {
+        return a.height > b.height;
+    });
+
+    TextureAtlas atlas { pageSize, padding };
+    bool failed = false;
+    for (const Image &image : images)
+    {
+        failed |= atlas.add(image.path, image.data, image.width, image.height, image.channels) < 0;
+        stbi_image_free(image.data);
+    }
+
+    if (failed || !atlas.write(prefix))
+    {
+        std::cerr << "Failed to write " << prefix << std::endl;
+        return 1;
+    }
+
+    std::cout << images.size() << " image(s) -> " << prefix << " (" << atlas.pageCount() << " page(s) of "
+              << pageSize << "x" << pageSize << ", " << atlas.occupancy() * 100.0f << "% used)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,67 @@
+// Offline mesh baker: reads a Wavefront .obj, quantizes it with
+// MeshQuantizer and writes a .qmesh that QuantizedMeshFile can mmap.
+//
+//     meshbake [--glsl decode.glsl] input.obj output.qmesh
+//
+// The .obj is read with MeshQuantizer::loadObj(), see there for what it
+// understands. --glsl also writes the shader decode snippet.
+
+#include "../wrappers/mesh_quantizer.hpp"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+int main(int argc, char** argv)
+{
+    const char* glslPath = nullptr;
+
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if (std::strcmp(argv[arg], "--glsl") == 0 && arg + 1 < argc)
+            glslPath = argv[++arg];
+        else
+            break;
+    }
+
+    if (argc - arg != 2)
+    {
+        std::cerr << "Usage: meshbake [--glsl decode.glsl] input.obj output.qmesh" << std::endl;
+        return 1;
+    }
+
+    const char* input = argv[arg];
+    const char* output = argv[arg + 1];
+
+    std::vector<BatchVertex> vertices;
+    std::vector<GLuint> indices;
+    if (!MeshQuantizer::loadObj(input, vertices, indices))
+        return 1;
+
+    if (vertices.empty() || indices.empty())
+    {
+        std::cerr << input << " has no faces" << std::endl;
+        return 1;
+    }
+
+    QuantizedMesh mesh = MeshQuantizer::quantize(vertices.data(), vertices.size(), indices.data(), indices.size());
+    if (!QuantizedMeshFile::write(output, mesh))
+    {
+        std::cerr << "Failed to write " << output << std::endl;
+        return 1;
+    }
+
+    if (glslPath && !(std::ofstream(glslPath) << MeshQuantizer::decodeGLSL()))
+    {
+        std::cerr << "Failed to write " << glslPath << std::endl;
+        return 1;
+    }
+
+    QuantizationError error = MeshQuantizer::measure(vertices.data(), mesh);
+    std::cout << input << " -> " << output << " (" << vertices.size() << " vertices, " << indices.size() / 3
+              << " triangles, " << vertices.size() * sizeof(BatchVertex) << " -> "
+              << vertices.size() * sizeof(QuantizedVertex) << " vertex bytes)\n"
+              << "max error: position " << error.maxPosition << " (rms " << error.rmsPosition << "), texCoord "
+              << error.maxTexCoord << ", color " << error.maxColor << std::endl;
+    return 0;
+}
@@ -0,0 +1,68 @@
+// Offline texture baker: decodes an image with stb_image, builds its full
+// mip chain and writes it as a .txb file that TextureLoader can mmap.
+//
+//     texbake [--no-flip] [--srgb] [--kaiser] input.png output.txb
+//
+// --srgb averages color in linear light, --kaiser swaps the 2x2 box filter
+// for a sharper Kaiser-windowed sinc.
+
+#include "../wrappers/mipmap.hpp"
+#include "../wrappers/texture_file.hpp"
+#include "../wrappers/thread_pool.hpp"
+#include <iostream>
+#include <cstring>
+#include <stb_image.h>
+
+int main(int argc, char** argv)
+{
+    ThreadPool pool;
+    MipOptions options;
+    options.pool = &pool;
+
+    bool flip = true;
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if (std::strcmp(argv[arg], "--no-flip") == 0)
+            flip = false;
+        else if (std::strcmp(argv[arg], "--srgb") == 0)
+            options.srgb = true;
+        else if (std::strcmp(argv[arg], "--kaiser") == 0)
+            options.filter = MipFilter::Kaiser;
+        else
+            break;
+    }
+
+    if (argc - arg != 2)
+    {
+        std::cerr << "Usage: texbake [--no-flip] [--srgb] [--kaiser] input output.txb" << std::endl;
+        return 1;
+    }
+
+    const char* input = argv[arg];
+    const char* output = argv[arg + 1];
+
+    // Bake the image the way GL wants it, (0,0) at the bottom left
+    stbi_set_flip_vertically_on_load(flip);
+
+    int width, height, channels;
+    unsigned char* data = stbi_load(input, &width, &height, &channels, 0);
+    if (!data)
+    {
+        std::cerr << "Failed to load " << input << ": " << stbi_failure_reason() << std::endl;
+        return 1;
+    }
+
+    std::vector<MipLevel> levels = buildMipChain(data, width, height, channels, options);
+    stbi_image_free(data);
+
+    if (!TextureFile::write(output, levels, channels))
+    {
+        std::cerr << "Failed to write " << output << std::endl;
+        return 1;
+    }
+
+    std::cout << input << " -> " << output << " (" << width << "x" << height << ", "
+              << channels << " channels, " << levels.size() << " levels)" << std::endl;
+    return 0;
+}
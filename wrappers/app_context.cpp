@@ -0,0 +1,328 @@
+#include "app_context.hpp"
+#include "gl_state.hpp"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    const int defaultHeadlessFrames = 300;
+
+    const EGLint headlessContextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+}
+
+SharedContext::~SharedContext()
+{
+    if (_window)
+    {
+        glfwDestroyWindow(_window);
+        return;
+    }
+
+    EGLDisplay display = (EGLDisplay) _eglDisplay;
+    if (_eglSurface)
+        eglDestroySurface(display, (EGLSurface) _eglSurface);
+    if (_eglContext)
+        eglDestroyContext(display, (EGLContext) _eglContext);
+}
+
+bool SharedContext::makeCurrent(bool current) const
+{
+    if (_window)
+    {
+        glfwMakeContextCurrent(current ? _window : NULL);
+        return true;
+    }
+
+    // The bound API is per thread, and a new thread starts with GL ES
+    eglBindAPI(EGL_OPENGL_API);
+    EGLSurface surface = current && _eglSurface ? (EGLSurface) _eglSurface : EGL_NO_SURFACE;
+    return eglMakeCurrent((EGLDisplay) _eglDisplay, surface, surface,
+                          current ? (EGLContext) _eglContext : EGL_NO_CONTEXT);
+}
+
+AppContext::AppContext(int width, int height, const char* title, int argc, char** argv)
+    : _width(width), _height(height)
+{
+    if (const char* env = std::getenv("LEARNGL_HEADLESS"))
+        _frameLimit = std::max(1, std::atoi(env));
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--headless") == 0)
+        {
+            _frameLimit = defaultHeadlessFrames;
+            if (i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+                _frameLimit = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--frame-times") == 0 && i + 1 < argc)
+            _frameTimesPath = argv[++i];
+        else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+            _tracePath = argv[++i];
+    }
+
+    _valid = _frameLimit > 0 ? createHeadless() : createWindow(title);
+
+    // Fresh context, nothing the state cache remembers applies to it
+    GLState::invalidate();
+    _start = _frameStart = std::chrono::steady_clock::now();
+}
+
+AppContext::~AppContext()
+{
+    if (_window)
+    {
+        glfwTerminate();
+        return;
+    }
+
+    if (_valid)
+    {
+        reportFrameTimes();
+        glDeleteFramebuffers(1, &_fbo);
+        glDeleteRenderbuffers(1, &_colorBuffer);
+    }
+
+    EGLDisplay display = (EGLDisplay) _eglDisplay;
+    if (display != EGL_NO_DISPLAY)
+    {
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (_eglSurface)
+            eglDestroySurface(display, (EGLSurface) _eglSurface);
+        if (_eglContext)
+            eglDestroyContext(display, (EGLContext) _eglContext);
+        eglTerminate(display);
+    }
+}
+
+bool AppContext::createWindow(const char* title)
+{
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+    _window = glfwCreateWindow(_width, _height, title, NULL, NULL);
+    if (_window == NULL)
+    {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return false;
+    }
+    glfwMakeContextCurrent(_window);
+
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool AppContext::createHeadless()
+{
+    // Surfaceless needs no config or surface at all, otherwise fall back to
+    // the default display and a tiny pbuffer just to make the context current
+    EGLDisplay display = EGL_NO_DISPLAY;
+    bool surfaceless = false;
+
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay && clientExtensions && std::strstr(clientExtensions, "EGL_MESA_platform_surfaceless"))
+    {
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        surfaceless = display != EGL_NO_DISPLAY;
+    }
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    _eglDisplay = display;
+    EGLint major, minor;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+    {
+        std::cout << "Failed to initialize EGL" << std::endl;
+        _eglDisplay = EGL_NO_DISPLAY;
+        return false;
+    }
+    eglBindAPI(EGL_OPENGL_API);
+
+    EGLConfig config = EGL_NO_CONFIG_KHR;
+    if (!surfaceless)
+    {
+        const EGLint configAttribs[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_NONE
+        };
+        EGLint count = 0;
+        if (!eglChooseConfig(display, configAttribs, &config, 1, &count) || count == 0)
+        {
+            std::cout << "Failed to find an EGL pbuffer config" << std::endl;
+            return false;
+        }
+
+        const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        _eglSurface = eglCreatePbufferSurface(display, config, pbufferAttribs);
+    }
+
+    _eglConfig = config;
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, headlessContextAttribs);
+    if (context == EGL_NO_CONTEXT)
+    {
+        std::cout << "Failed to create EGL context" << std::endl;
+        return false;
+    }
+    _eglContext = context;
+
+    EGLSurface surface = _eglSurface ? (EGLSurface) _eglSurface : EGL_NO_SURFACE;
+    if (!eglMakeCurrent(display, surface, surface, context))
+    {
+        std::cout << "Failed to make the EGL context current" << std::endl;
+        return false;
+    }
+
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return false;
+    }
+
+    // Samples draw to "the screen", which is this FBO from now on
+    glGenRenderbuffers(1, &_colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, _colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, _width, _height);
+
+    glGenFramebuffers(1, &_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _colorBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "Failed to create the offscreen framebuffer" << std::endl;
+        return false;
+    }
+
+    // A window's context starts with the viewport covering it. Without a
+    // surface it starts at 0x0, and anything not setting its own (the
+    // bench scenarios) would rasterize nothing.
+    glViewport(0, 0, _width, _height);
+
+    std::cout << "Headless: " << glGetString(GL_RENDERER) << ", " << _frameLimit << " frames" << std::endl;
+    return true;
+}
+
+std::unique_ptr<SharedContext> AppContext::createSharedContext() const
+{
+    if (!_valid)
+        return nullptr;
+
+    std::unique_ptr<SharedContext> shared(new SharedContext());
+    if (_window)
+    {
+        // A hidden window just for its context, with the hints the main one
+        // was made with
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        shared->_window = glfwCreateWindow(1, 1, "", NULL, _window);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+        if (shared->_window == NULL)
+        {
+            std::cout << "ERROR::APP_CONTEXT::SHARED_CONTEXT_FAILED" << std::endl;
+            return nullptr;
+        }
+        return shared;
+    }
+
+    EGLDisplay display = (EGLDisplay) _eglDisplay;
+    shared->_eglDisplay = display;
+    EGLContext context = eglCreateContext(display, (EGLConfig) _eglConfig, (EGLContext) _eglContext,
+                                          headlessContextAttribs);
+    if (context == EGL_NO_CONTEXT)
+    {
+        std::cout << "ERROR::APP_CONTEXT::SHARED_CONTEXT_FAILED" << std::endl;
+        return nullptr;
+    }
+    shared->_eglContext = context;
+
+    // Like the main context, a pbuffer of its own unless surfaceless
+    if (_eglSurface)
+    {
+        const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        shared->_eglSurface = eglCreatePbufferSurface(display, (EGLConfig) _eglConfig, pbufferAttribs);
+        if (shared->_eglSurface == EGL_NO_SURFACE)
+        {
+            std::cout << "ERROR::APP_CONTEXT::SHARED_CONTEXT_FAILED" << std::endl;
+            return nullptr;
+        }
+    }
+    return shared;
+}
+
+double AppContext::time() const
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+}
+
+bool AppContext::shouldClose() const
+{
+    if (_window)
+        return glfwWindowShouldClose(_window);
+    return !_valid || _frame >= _frameLimit;
+}
+
+void AppContext::endFrame()
+{
+    if (_window)
+    {
+        glfwSwapBuffers(_window);
+        glfwPollEvents();
+        return;
+    }
+
+    // Nothing gets presented, so wait on the GPU to keep frames from piling
+    // up and to get an honest wall time
+    auto submitted = std::chrono::steady_clock::now();
+    glFinish();
+    auto finished = std::chrono::steady_clock::now();
+
+    _frameTimes.push_back({
+        std::chrono::duration<double, std::milli>(submitted - _frameStart).count(),
+        std::chrono::duration<double, std::milli>(finished - _frameStart).count()
+    });
+
+    _frame++;
+    _frameStart = finished;
+}
+
+void AppContext::reportFrameTimes() const
+{
+    if (_frameTimes.empty())
+        return;
+
+    std::vector<double> cpu;
+    for (const FrameTime &time : _frameTimes)
+        cpu.push_back(time.cpuMs);
+    std::sort(cpu.begin(), cpu.end());
+
+    double total = 0.0;
+    for (double ms : cpu)
+        total += ms;
+
+    std::cout << "Frame CPU time over " << cpu.size() << " frames: avg " << total / cpu.size()
+              << " ms, median " << cpu[cpu.size() / 2] << " ms, max " << cpu.back() << " ms" << std::endl;
+
+    if (!_frameTimesPath.empty())
+    {
+        std::ofstream file(_frameTimesPath);
+        file << "frame,cpu_ms,wall_ms\n";
+        for (size_t i = 0; i < _frameTimes.size(); i++)
+            file << i << "," << _frameTimes[i].cpuMs << "," << _frameTimes[i].wallMs << "\n";
+    }
+}
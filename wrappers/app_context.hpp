@@ -0,0 +1,124 @@
+#ifndef APP_CONTEXT_H_
+#define APP_CONTEXT_H_
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+// A second context sharing objects (programs, textures, buffers) with an
+// AppContext's, for a worker thread to do GL work on without touching the
+// render thread. Made and destroyed on the main thread; the worker releases
+// it before it goes. GLState's cache is the render thread's, so code running
+// on it uses plain GL calls.
+class SharedContext
+{
+    GLFWwindow* _window = nullptr;
+    void* _eglDisplay = nullptr;
+    void* _eglContext = nullptr;
+    void* _eglSurface = nullptr;
+
+    friend class AppContext;
+    SharedContext() {}
+
+    public:
+        ~SharedContext();
+
+        SharedContext(const SharedContext&) = delete;
+        SharedContext& operator=(const SharedContext&) = delete;
+
+        // Makes it current on the calling thread, or with false releases it
+        bool makeCurrent(bool current = true) const;
+};
+
+// Creates the GL 3.3 core context a sample renders with and runs its frames.
+//
+// Normally that's a GLFW window. Started with `--headless [frames]` (or with
+// LEARNGL_HEADLESS=frames in the environment) it's instead an EGL context
+// with no window at all: surfaceless when Mesa offers it, a pbuffer
+// otherwise. Everything renders into an offscreen framebuffer object, the
+// loop stops after a fixed number of frames and per-frame CPU timings are
+// reported, so samples run on GPU-less machines (Mesa llvmpipe).
+// `--frame-times file.csv` also writes every frame's timings, and
+// `--trace file.json` names where a sample should dump its profiler trace.
+//
+// GLAD is loaded by the constructor, and the destructor tears the context
+// down, so declare this before any other GL object in main().
+class AppContext
+{
+    public:
+        struct FrameTime
+        {
+            double cpuMs;  // from the start of the frame until endFrame()
+            double wallMs; // including waiting for the GPU to finish it
+        };
+
+    private:
+    int _width;
+    int _height;
+    bool _valid = false;
+
+    GLFWwindow* _window = nullptr;
+
+    // Headless state, EGL handles kept opaque so the header stays GLFW only
+    void* _eglDisplay = nullptr;
+    void* _eglContext = nullptr;
+    void* _eglSurface = nullptr;
+    void* _eglConfig = nullptr;
+    GLuint _fbo = 0;
+    GLuint _colorBuffer = 0;
+    int _frameLimit = 0;
+    std::string _frameTimesPath;
+    std::string _tracePath;
+
+    int _frame = 0;
+    std::chrono::steady_clock::time_point _start;
+    std::chrono::steady_clock::time_point _frameStart;
+    std::vector<FrameTime> _frameTimes;
+
+    bool createWindow(const char* title);
+    bool createHeadless();
+    void reportFrameTimes() const;
+
+    public:
+        AppContext(int width, int height, const char* title, int argc = 0, char** argv = nullptr);
+        ~AppContext();
+
+        AppContext(const AppContext&) = delete;
+        AppContext& operator=(const AppContext&) = delete;
+
+        // False if the context couldn't be created (already reported)
+        bool valid() const { return _valid; }
+        bool headless() const { return _window == nullptr; }
+
+        // Null when headless, so guard input handling with it
+        GLFWwindow* window() const { return _window; }
+
+        // Null if no context can share with this one (already reported)
+        std::unique_ptr<SharedContext> createSharedContext() const;
+
+        int width() const { return _width; }
+        int height() const { return _height; }
+
+        // Seconds since the context was made. Use it instead of
+        // glfwGetTime(), which GLFW only answers once initialized, and
+        // headless it never is.
+        double time() const;
+
+        // True once the window was closed or the frame count was reached
+        bool shouldClose() const;
+
+        // Presents the frame: swap and poll events, or headless, wait for the
+        // GPU and record the frame's timings
+        void endFrame();
+
+        const std::vector<FrameTime>& frameTimes() const { return _frameTimes; }
+
+        // Empty unless `--trace file.json` was passed
+        const std::string& tracePath() const { return _tracePath; }
+};
+
+#endif // APP_CONTEXT_H_
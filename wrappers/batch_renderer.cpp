@@ -0,0 +1,156 @@
+#include "batch_renderer.hpp"
+#include "gl_state.hpp"
+#include <algorithm>
+
+BatchRenderer::BatchRenderer()
+{
+    glGenVertexArrays(1, &_vao);
+    glGenBuffers(1, &_vbo);
+    glGenBuffers(1, &_ebo);
+
+    GLState::bindVertexArray(_vao);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, _vbo);
+    GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ebo);
+
+    BatchVertexLayout::apply();
+
+    GLState::bindVertexArray(0);
+}
+
+BatchRenderer::~BatchRenderer()
+{
+    GLState::deleteVertexArrays(1, &_vao);
+    GLState::deleteBuffers(1, &_vbo);
+    GLState::deleteBuffers(1, &_ebo);
+}
+
+void BatchRenderer::begin()
+{
+    _vertices.clear();
+    _indices.clear();
+    _items.clear();
+    _stats = Stats();
+}
+
+void BatchRenderer::submit(Shader &shader, GLuint texture, const BatchVertex* vertices, size_t vertexCount,
+                           const GLuint* indices, size_t indexCount)
+{
+    _items.push_back({ &shader, texture, (GLuint) _vertices.size(), (GLuint) _indices.size(), (GLuint) indexCount });
+    _vertices.insert(_vertices.end(), vertices, vertices + vertexCount);
+    _indices.insert(_indices.end(), indices, indices + indexCount);
+}
+
+void BatchRenderer::sprite(Shader &shader, GLuint texture, float x, float y, float width, float height,
+                           const float color[3], float z, const float uv[4])
+{
+    static const float wholeTexture[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+    if (!uv)
+        uv = wholeTexture;
+
+    const float r = color[0], g = color[1], b = color[2];
+    BatchVertex vertices[4] = {
+        { { x + width, y + height, z }, { r, g, b }, { uv[2], uv[3] } }, // top right
+        { { x + width, y, z },          { r, g, b }, { uv[2], uv[1] } }, // bottom right
+        { { x, y, z },                  { r, g, b }, { uv[0], uv[1] } }, // bottom left
+        { { x, y + height, z },         { r, g, b }, { uv[0], uv[3] } }  // top left
+    };
+    static const GLuint indices[6] = { 0, 1, 3, 1, 2, 3 };
+    submit(shader, texture, vertices, 4, indices, 6);
+}
+
+void BatchRenderer::upload()
+{
+    GLsizeiptr vertexBytes = _vertices.size() * sizeof(BatchVertex);
+    GLsizeiptr indexBytes = _sortedIndices.size() * sizeof(GLuint);
+
+    // Orphan the old storage every batch so we never wait on the GPU still
+    // drawing last frame's geometry; grow it in powers of two
+    GLState::bindBuffer(GL_ARRAY_BUFFER, _vbo);
+    if (vertexBytes > _vertexCapacity)
+        while (_vertexCapacity < vertexBytes)
+            _vertexCapacity = std::max<GLsizeiptr>(_vertexCapacity * 2, 64 * 1024);
+    glBufferData(GL_ARRAY_BUFFER, _vertexCapacity, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, vertexBytes, _vertices.data());
+
+    if (indexBytes > _indexCapacity)
+        while (_indexCapacity < indexBytes)
+            _indexCapacity = std::max<GLsizeiptr>(_indexCapacity * 2, 64 * 1024);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, _indexCapacity, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indexBytes, _sortedIndices.data());
+}
+
+void BatchRenderer::end()
+{
+    _stats.objects = _items.size();
+    _stats.vertices = _vertices.size();
+    _stats.indices = _indices.size();
+    if (_items.empty())
+        return;
+
+    _order.resize(_items.size());
+    for (size_t i = 0; i < _order.size(); i++)
+        _order[i] = i;
+
+    std::stable_sort(_order.begin(), _order.end(), [this] (size_t a, size_t b) {
+        const Item &x = _items[a];
+        const Item &y = _items[b];
+        if (x.shader != y.shader)
+            return x.shader < y.shader;
+        return x.texture < y.texture;
+    });
+
+    // Lay the indices out in draw order, pointing at batch-wide vertices
+    _sortedIndices.resize(_indices.size());
+    GLuint* out = _sortedIndices.data();
+    for (size_t i : _order)
+    {
+        const Item &item = _items[i];
+        const GLuint* in = _indices.data() + item.firstIndex;
+        for (GLuint j = 0; j < item.indexCount; j++)
+            *out++ = in[j] + item.firstVertex;
+    }
+
+    GLState::bindVertexArray(_vao);
+    upload();
+    GLState::activeTexture(GL_TEXTURE0);
+
+    // One draw for every run of items sharing shader and texture
+    Shader* shader = nullptr;
+    GLuint texture = 0;
+    bool first = true;
+    size_t start = 0;
+    size_t count = 0;
+
+    auto flush = [&] () {
+        if (count == 0)
+            return;
+        glDrawElements(GL_TRIANGLES, (GLsizei) count, GL_UNSIGNED_INT, (void*) (start * sizeof(GLuint)));
+        _stats.drawCalls++;
+        start += count;
+        count = 0;
+    };
+
+    for (size_t i : _order)
+    {
+        const Item &item = _items[i];
+        if (first || item.shader != shader || item.texture != texture)
+        {
+            flush();
+            if (first || item.shader != shader)
+            {
+                item.shader->use();
+                _stats.programChanges++;
+            }
+            if (first || item.texture != texture)
+            {
+                GLState::bindTexture(GL_TEXTURE_2D, item.texture);
+                _stats.textureChanges++;
+            }
+            shader = item.shader;
+            texture = item.texture;
+            first = false;
+        }
+        count += item.indexCount;
+    }
+    flush();
+}
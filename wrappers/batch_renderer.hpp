@@ -0,0 +1,105 @@
+#ifndef BATCH_RENDERER_H_
+#define BATCH_RENDERER_H_
+
+#include "shader.hpp"
+#include "vertex_layout.hpp"
+
+#include <glad/glad.h>
+
+#include <vector>
+
+// Same layout as the textures sample: position, color, texture coords at
+// attribute locations 0, 1 and 2, so its shaders work unchanged.
+struct BatchVertex
+{
+    vertex::vec3 position;
+    vertex::vec3 color;
+    vertex::vec2 texCoord;
+};
+typedef VertexLayout<vertex::vec3, vertex::vec3, vertex::vec2> BatchVertexLayout;
+VERTEX_ATTRIBUTE(BatchVertexLayout, BatchVertex, 0, position);
+VERTEX_ATTRIBUTE(BatchVertexLayout, BatchVertex, 1, color);
+VERTEX_ATTRIBUTE(BatchVertexLayout, BatchVertex, 2, texCoord);
+
+// Collects the geometry of many objects into one dynamic vertex/index
+// buffer and draws it with as few glDrawElements calls as it can.
+//
+//     batch.begin();
+//     for (const Sprite &s : sprites)
+//         batch.sprite(spriteShader, s.texture, s.x, s.y, s.w, s.h, s.color);
+//     batch.end(); // one draw per (shader, texture) pair
+//
+// end() sorts everything by shader, then texture, keeping submission order
+// within each pair. Objects with different state can therefore end up
+// drawn out of order, so overlapping blended geometry should be layered
+// with depth testing (the z of each vertex) instead.
+class BatchRenderer
+{
+    public:
+        struct Stats
+        {
+            unsigned drawCalls = 0;
+            unsigned programChanges = 0;
+            unsigned textureChanges = 0;
+            unsigned objects = 0;
+            unsigned vertices = 0;
+            unsigned indices = 0;
+        };
+
+    private:
+    // One submit(): where its geometry sits in the CPU-side arrays
+    struct Item
+    {
+        Shader* shader;
+        GLuint texture;
+        GLuint firstVertex;
+        GLuint firstIndex;
+        GLuint indexCount;
+    };
+
+    GLuint _vao;
+    GLuint _vbo;
+    GLuint _ebo;
+    GLsizeiptr _vertexCapacity = 0;
+    GLsizeiptr _indexCapacity = 0;
+
+    std::vector<BatchVertex> _vertices;
+    std::vector<GLuint> _indices;       // relative to each item's first vertex
+    std::vector<GLuint> _sortedIndices; // rebased and in draw order
+    std::vector<Item> _items;
+    std::vector<size_t> _order;
+
+    Stats _stats;
+
+    void upload();
+
+    public:
+        BatchRenderer();
+        ~BatchRenderer();
+
+        BatchRenderer(const BatchRenderer&) = delete;
+        BatchRenderer& operator=(const BatchRenderer&) = delete;
+
+        // Starts a new batch and resets the stats
+        void begin();
+
+        // Queues indexed triangles. Indices count from the first of these
+        // vertices, not from the start of the batch.
+        void submit(Shader &shader, GLuint texture, const BatchVertex* vertices, size_t vertexCount,
+                    const GLuint* indices, size_t indexCount);
+
+        // Queues an axis-aligned textured quad, (x, y) being its bottom left.
+        // uv is the (u0, v0, u1, v1) rectangle to show, e.g. AtlasRegion::uv;
+        // the whole texture when null.
+        void sprite(Shader &shader, GLuint texture, float x, float y, float width, float height,
+                    const float color[3], float z = 0.0f, const float uv[4] = nullptr);
+
+        // Sorts, uploads and draws everything since begin(). Leaves texture
+        // unit 0 active and the batch's VAO bound.
+        void end();
+
+        // Counters for the last batch
+        const Stats& stats() const { return _stats; }
+};
+
+#endif // BATCH_RENDERER_H_
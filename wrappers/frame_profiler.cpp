@@ -0,0 +1,168 @@
+#include "frame_profiler.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+    // Frames in flight we can measure without waiting on a result
+    const size_t gpuQueryCount = 4;
+
+    const char* frameName = "frame";
+    const char* gpuName = "gpu";
+}
+
+FrameProfiler::Zone::Zone(FrameProfiler &profiler, const char* name)
+    : _profiler(profiler), _name(name), _start(profiler.nowUs())
+{
+}
+
+FrameProfiler::Zone::~Zone()
+{
+    _profiler.record(_name, 0, _start, _profiler.nowUs() - _start);
+}
+
+FrameProfiler::FrameProfiler(size_t window, size_t maxEvents)
+    : _origin(std::chrono::steady_clock::now()), _window(window), _maxEvents(maxEvents)
+{
+    _queries.resize(gpuQueryCount);
+    for (GpuQuery &query : _queries)
+        glGenQueries(1, &query.query);
+}
+
+FrameProfiler::~FrameProfiler()
+{
+    for (GpuQuery &query : _queries)
+        glDeleteQueries(1, &query.query);
+}
+
+double FrameProfiler::nowUs() const
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - _origin).count();
+}
+
+void FrameProfiler::record(const char* name, int track, double startUs, double durationUs)
+{
+    std::deque<double> &samples = _series[name].samples;
+    samples.push_back(durationUs / 1000.0);
+    if (samples.size() > _window)
+        samples.pop_front();
+
+    _events.push_back({ name, track, startUs, durationUs });
+    if (_events.size() > _maxEvents)
+        _events.pop_front();
+}
+
+void FrameProfiler::beginFrame()
+{
+    collectGpuResults();
+
+    _frameStartUs = nowUs();
+
+    GpuQuery &query = _queries[_nextQuery];
+    if (query.pending)
+    {
+        _droppedGpuFrames++;
+        _queryActive = false;
+        return;
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, query.query);
+    query.frameStartUs = _frameStartUs;
+    _queryActive = true;
+}
+
+void FrameProfiler::endFrame()
+{
+    if (_queryActive)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        _queries[_nextQuery].pending = true;
+        _nextQuery = (_nextQuery + 1) % _queries.size();
+        _queryActive = false;
+    }
+
+    record(frameName, 0, _frameStartUs, nowUs() - _frameStartUs);
+}
+
+void FrameProfiler::collectGpuResults()
+{
+    // Oldest first, so results land in frame order
+    for (size_t i = 0; i < _queries.size(); i++)
+    {
+        GpuQuery &query = _queries[(_nextQuery + i) % _queries.size()];
+        if (!query.pending)
+            continue;
+
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(query.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            break;
+
+        GLuint64 elapsedNs = 0;
+        glGetQueryObjectui64v(query.query, GL_QUERY_RESULT, &elapsedNs);
+        query.pending = false;
+
+        // The GPU can't have spent longer on the frame than has passed since
+        // it began; llvmpipe reports garbage for its very first query
+        double elapsedUs = elapsedNs / 1000.0;
+        if (elapsedUs > nowUs() - query.frameStartUs)
+        {
+            _droppedGpuFrames++;
+            continue;
+        }
+
+        // There's no shared clock with the GPU here, so the event is drawn
+        // from the CPU start of its frame
+        record(gpuName, 1, query.frameStartUs, elapsedUs);
+    }
+}
+
+FrameProfiler::Percentiles FrameProfiler::percentiles(const std::string &series) const
+{
+    Percentiles result;
+    auto it = _series.find(series);
+    if (it == _series.end() || it->second.samples.empty())
+        return result;
+
+    std::vector<double> sorted(it->second.samples.begin(), it->second.samples.end());
+    std::sort(sorted.begin(), sorted.end());
+
+    auto at = [&](double p) { return sorted[std::min(sorted.size() - 1, (size_t) (p * sorted.size()))]; };
+    result.p50 = at(0.50);
+    result.p95 = at(0.95);
+    result.p99 = at(0.99);
+    return result;
+}
+
+bool FrameProfiler::writeTrace(const char* path) const
+{
+    std::ofstream file(path);
+
+    // Microseconds to the nanosecond. The default 6 significant digits
+    // would round timestamps to 10 us and coarser once a run passes a
+    // second, and zones would overlap in the viewer.
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"CPU\"}},\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"GPU\"}}";
+    for (const TraceEvent &event : _events)
+    {
+        file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.track
+             << ",\"ts\":" << event.startUs << ",\"dur\":" << event.durationUs << "}";
+    }
+    file << "\n]}\n";
+    return (bool) file;
+}
+
+std::string FrameProfiler::summary() const
+{
+    std::ostringstream out;
+    for (const auto &pair : _series)
+    {
+        Percentiles p = percentiles(pair.first);
+        out << pair.first << ": p50 " << p.p50 << " ms, p95 " << p.p95 << " ms, p99 " << p.p99 << " ms\n";
+    }
+    return out.str();
+}
@@ -0,0 +1,121 @@
+#ifndef FRAME_PROFILER_H_
+#define FRAME_PROFILER_H_
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+// Per-frame CPU and GPU timings with rolling percentiles, plus a trace
+// Chrome can load (chrome://tracing or ui.perfetto.dev).
+//
+//     FrameProfiler profiler;
+//     while (running)
+//     {
+//         profiler.beginFrame();
+//         {
+//             FrameProfiler::Zone zone { profiler, "draw" };
+//             ...
+//         }
+//         profiler.endFrame();
+//     }
+//     profiler.writeTrace("trace.json");
+//
+// The GPU side is one GL_TIME_ELAPSED query per frame, taken from a small
+// ring and only read back once GL_QUERY_RESULT_AVAILABLE says so, which
+// never stalls the pipeline. A frame whose query slot is still busy just
+// goes unmeasured on the GPU side.
+class FrameProfiler
+{
+    public:
+        struct Percentiles
+        {
+            double p50 = 0.0;
+            double p95 = 0.0;
+            double p99 = 0.0;
+        };
+
+        // Scoped CPU zone. Zones can nest, name must outlive the profiler
+        // (a string literal, typically).
+        class Zone
+        {
+            FrameProfiler &_profiler;
+            const char* _name;
+            double _start;
+
+            public:
+                Zone(FrameProfiler &profiler, const char* name);
+                ~Zone();
+                Zone(const Zone&) = delete;
+                Zone& operator=(const Zone&) = delete;
+        };
+
+    private:
+    struct TraceEvent
+    {
+        const char* name;
+        int track; // 0 is the CPU, 1 the GPU
+        double startUs;
+        double durationUs;
+    };
+
+    struct GpuQuery
+    {
+        GLuint query;
+        bool pending = false;
+        double frameStartUs = 0.0;
+    };
+
+    // Last _window samples of one timing series, in milliseconds
+    struct Series
+    {
+        std::deque<double> samples;
+    };
+
+    std::chrono::steady_clock::time_point _origin;
+    size_t _window;
+    size_t _maxEvents;
+
+    std::vector<GpuQuery> _queries;
+    size_t _nextQuery = 0;
+    bool _queryActive = false;
+    unsigned _droppedGpuFrames = 0;
+
+    double _frameStartUs = 0.0;
+    std::map<std::string, Series> _series;
+    std::deque<TraceEvent> _events;
+
+    double nowUs() const;
+    void record(const char* name, int track, double startUs, double durationUs);
+    void collectGpuResults();
+
+    public:
+        // window is how many recent frames the percentiles cover, maxEvents
+        // caps how much of the run the trace keeps (oldest events go first)
+        explicit FrameProfiler(size_t window = 240, size_t maxEvents = 100000);
+        ~FrameProfiler();
+
+        FrameProfiler(const FrameProfiler&) = delete;
+        FrameProfiler& operator=(const FrameProfiler&) = delete;
+
+        void beginFrame();
+        void endFrame();
+
+        // "frame" and "gpu" are the whole-frame series, zones use their name
+        Percentiles percentiles(const std::string &series) const;
+
+        // GPU frames skipped because every query slot was still in flight,
+        // or whose result was impossible
+        unsigned droppedGpuFrames() const { return _droppedGpuFrames; }
+
+        // Trace Event Format JSON, false if the file couldn't be written
+        bool writeTrace(const char* path) const;
+
+        // One line per series with its percentiles
+        std::string summary() const;
+};
+
+#endif // FRAME_PROFILER_H_
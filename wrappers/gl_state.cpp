@@ -0,0 +1,268 @@
+#include "gl_state.hpp"
+
+namespace
+{
+    // Means "whatever the driver has", so the next call is always issued
+    constexpr GLuint Unknown = ~0u;
+
+    constexpr int BufferTargets = 8;
+    constexpr int TextureTargets = 4;
+    constexpr int TextureUnits = 32;
+    constexpr int Caps = 4;
+
+    struct Shadow
+    {
+        GLuint program;
+        GLuint vertexArray;
+        GLuint buffers[BufferTargets];
+
+        GLuint activeUnit; // index, not the GL_TEXTUREi enum
+        GLuint textures[TextureUnits][TextureTargets];
+
+        GLuint caps[Caps]; // GL_TRUE/GL_FALSE
+        GLenum blendSrc;
+        GLenum blendDst;
+        GLenum depthFunc;
+        GLuint depthMask;
+    };
+
+    Shadow makeUnknown()
+    {
+        Shadow shadow;
+        shadow.program = Unknown;
+        shadow.vertexArray = Unknown;
+        for (GLuint &buffer : shadow.buffers)
+            buffer = Unknown;
+        shadow.activeUnit = Unknown;
+        for (auto &unit : shadow.textures)
+            for (GLuint &texture : unit)
+                texture = Unknown;
+        for (GLuint &cap : shadow.caps)
+            cap = Unknown;
+        shadow.blendSrc = Unknown;
+        shadow.blendDst = Unknown;
+        shadow.depthFunc = Unknown;
+        shadow.depthMask = Unknown;
+        return shadow;
+    }
+
+    Shadow s_shadow = makeUnknown();
+    GLState::Stats s_stats;
+
+    int bufferSlot(GLenum target)
+    {
+        switch (target)
+        {
+            case GL_ARRAY_BUFFER:         return 0;
+            case GL_ELEMENT_ARRAY_BUFFER: return 1;
+            case GL_PIXEL_PACK_BUFFER:    return 2;
+            case GL_PIXEL_UNPACK_BUFFER:  return 3;
+            case GL_DRAW_INDIRECT_BUFFER: return 4;
+            case GL_UNIFORM_BUFFER:       return 5;
+            case GL_COPY_READ_BUFFER:     return 6;
+            case GL_COPY_WRITE_BUFFER:    return 7;
+            default:                      return -1;
+        }
+    }
+
+    int textureSlot(GLenum target)
+    {
+        switch (target)
+        {
+            case GL_TEXTURE_2D:       return 0;
+            case GL_TEXTURE_2D_ARRAY: return 1;
+            case GL_TEXTURE_3D:       return 2;
+            case GL_TEXTURE_CUBE_MAP: return 3;
+            default:                  return -1;
+        }
+    }
+
+    int capSlot(GLenum cap)
+    {
+        switch (cap)
+        {
+            case GL_BLEND:        return 0;
+            case GL_DEPTH_TEST:   return 1;
+            case GL_CULL_FACE:    return 2;
+            case GL_SCISSOR_TEST: return 3;
+            default:              return -1;
+        }
+    }
+
+    // Records the new value and says whether the call has to be issued
+    bool change(GLuint &shadowed, GLuint value)
+    {
+        if (shadowed == value)
+        {
+            s_stats.elided++;
+            return false;
+        }
+        shadowed = value;
+        s_stats.issued++;
+        return true;
+    }
+
+    void untracked()
+    {
+        s_stats.issued++;
+    }
+}
+
+void GLState::invalidate()
+{
+    s_shadow = makeUnknown();
+}
+
+void GLState::useProgram(GLuint program)
+{
+    if (change(s_shadow.program, program))
+        glUseProgram(program);
+}
+
+void GLState::bindVertexArray(GLuint vao)
+{
+    if (change(s_shadow.vertexArray, vao))
+    {
+        glBindVertexArray(vao);
+        s_shadow.buffers[bufferSlot(GL_ELEMENT_ARRAY_BUFFER)] = Unknown;
+    }
+}
+
+void GLState::bindBuffer(GLenum target, GLuint buffer)
+{
+    int slot = bufferSlot(target);
+    if (slot < 0)
+    {
+        untracked();
+        glBindBuffer(target, buffer);
+    }
+    else if (change(s_shadow.buffers[slot], buffer))
+        glBindBuffer(target, buffer);
+}
+
+void GLState::bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    untracked();
+    glBindBufferRange(target, index, buffer, offset, size);
+
+    int slot = bufferSlot(target);
+    if (slot >= 0)
+        s_shadow.buffers[slot] = buffer;
+}
+
+void GLState::activeTexture(GLenum unit)
+{
+    GLuint index = unit - GL_TEXTURE0;
+    if (index >= TextureUnits)
+    {
+        // Past what we shadow: issue it, and bindTexture stops tracking
+        untracked();
+        s_shadow.activeUnit = Unknown;
+        glActiveTexture(unit);
+    }
+    else if (change(s_shadow.activeUnit, index))
+        glActiveTexture(unit);
+}
+
+void GLState::bindTexture(GLenum target, GLuint texture)
+{
+    int slot = textureSlot(target);
+    if (slot < 0 || s_shadow.activeUnit == Unknown)
+    {
+        untracked();
+        glBindTexture(target, texture);
+    }
+    else if (change(s_shadow.textures[s_shadow.activeUnit][slot], texture))
+        glBindTexture(target, texture);
+}
+
+void GLState::enable(GLenum cap)
+{
+    int slot = capSlot(cap);
+    if (slot < 0)
+    {
+        untracked();
+        glEnable(cap);
+    }
+    else if (change(s_shadow.caps[slot], GL_TRUE))
+        glEnable(cap);
+}
+
+void GLState::disable(GLenum cap)
+{
+    int slot = capSlot(cap);
+    if (slot < 0)
+    {
+        untracked();
+        glDisable(cap);
+    }
+    else if (change(s_shadow.caps[slot], GL_FALSE))
+        glDisable(cap);
+}
+
+void GLState::blendFunc(GLenum sfactor, GLenum dfactor)
+{
+    if (s_shadow.blendSrc == sfactor && s_shadow.blendDst == dfactor)
+    {
+        s_stats.elided++;
+        return;
+    }
+    s_shadow.blendSrc = sfactor;
+    s_shadow.blendDst = dfactor;
+    s_stats.issued++;
+    glBlendFunc(sfactor, dfactor);
+}
+
+void GLState::depthFunc(GLenum func)
+{
+    if (change(s_shadow.depthFunc, func))
+        glDepthFunc(func);
+}
+
+void GLState::depthMask(GLboolean flag)
+{
+    if (change(s_shadow.depthMask, flag))
+        glDepthMask(flag);
+}
+
+void GLState::deleteTextures(GLsizei count, const GLuint* textures)
+{
+    for (GLsizei i = 0; i < count; i++)
+        for (auto &unit : s_shadow.textures)
+            for (GLuint &bound : unit)
+                if (bound == textures[i])
+                    bound = 0;
+    glDeleteTextures(count, textures);
+}
+
+void GLState::deleteBuffers(GLsizei count, const GLuint* buffers)
+{
+    for (GLsizei i = 0; i < count; i++)
+        for (GLuint &bound : s_shadow.buffers)
+            if (bound == buffers[i])
+                bound = 0;
+    glDeleteBuffers(count, buffers);
+}
+
+void GLState::deleteVertexArrays(GLsizei count, const GLuint* arrays)
+{
+    for (GLsizei i = 0; i < count; i++)
+    {
+        if (s_shadow.vertexArray == arrays[i])
+        {
+            s_shadow.vertexArray = 0;
+            s_shadow.buffers[bufferSlot(GL_ELEMENT_ARRAY_BUFFER)] = Unknown;
+        }
+    }
+    glDeleteVertexArrays(count, arrays);
+}
+
+const GLState::Stats& GLState::stats()
+{
+    return s_stats;
+}
+
+void GLState::resetStats()
+{
+    s_stats = Stats();
+}
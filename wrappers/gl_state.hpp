@@ -0,0 +1,67 @@
+#ifndef GL_STATE_H_
+#define GL_STATE_H_
+
+#include <glad/glad.h>
+
+#include <cstdint>
+
+// Shadow copy of the bind points the samples touch every frame, so a call
+// that wouldn't change anything never reaches the driver. The functions
+// are drop-in replacements for their gl* namesakes:
+//
+//     GLState::useProgram(program);           // glUseProgram
+//     GLState::activeTexture(GL_TEXTURE0);    // glActiveTexture
+//     GLState::bindTexture(GL_TEXTURE_2D, t); // glBindTexture
+//
+// Tracked: program, VAO, the common buffer targets, texture bindings per
+// unit, and blend/depth/cull/scissor state. Anything else passes straight
+// through. It shadows the current context on the GL thread only.
+//
+// The shadow is only right as long as every change goes through here.
+// Code that binds behind its back (or a new context) has to call
+// invalidate(), after which the next call of each kind is always issued.
+class GLState
+{
+    public:
+        struct Stats
+        {
+            std::uint64_t issued = 0;
+            std::uint64_t elided = 0;
+        };
+
+        // Forget everything, e.g. after making a new context current
+        static void invalidate();
+
+        static void useProgram(GLuint program);
+        static void bindVertexArray(GLuint vao);
+
+        // GL_ELEMENT_ARRAY_BUFFER is part of the VAO, so binding a VAO
+        // makes it unknown again
+        static void bindBuffer(GLenum target, GLuint buffer);
+
+        // Indexed bindings aren't shadowed (a ring moves the offset every
+        // frame anyway), but GL also binds the buffer to the generic target
+        static void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+        static void activeTexture(GLenum unit);
+        static void bindTexture(GLenum target, GLuint texture);
+
+        static void enable(GLenum cap);
+        static void disable(GLenum cap);
+        static void blendFunc(GLenum sfactor, GLenum dfactor);
+        static void depthFunc(GLenum func);
+        static void depthMask(GLboolean flag);
+
+        // Deleting unbinds the object wherever it is bound, and GL may hand
+        // the name out again, so deletes have to go through here too
+        static void deleteTextures(GLsizei count, const GLuint* textures);
+        static void deleteBuffers(GLsizei count, const GLuint* buffers);
+        static void deleteVertexArrays(GLsizei count, const GLuint* arrays);
+
+        // Running totals since startup (or the last resetStats). Take the
+        // difference across a frame for per-frame counts.
+        static const Stats& stats();
+        static void resetStats();
+};
+
+#endif // GL_STATE_H_
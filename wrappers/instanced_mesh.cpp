@@ -0,0 +1,55 @@
+#include "instanced_mesh.hpp"
+#include "gl_state.hpp"
+
+InstancedMesh::InstancedMesh(GLuint vao, GLsizei indexCount, GLenum indexType, GLuint firstLocation)
+    : _vao(vao), _indexCount(indexCount), _indexType(indexType)
+{
+    glGenBuffers(1, &_instanceBuffer);
+
+    GLState::bindVertexArray(_vao);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, _instanceBuffer);
+
+    glVertexAttribPointer(firstLocation, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                          (void*) offsetof(InstanceData, offset));
+    glVertexAttribPointer(firstLocation + 1, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                          (void*) offsetof(InstanceData, color));
+    // Integer attributes need the I variant, or they reach the shader as floats
+    glVertexAttribIPointer(firstLocation + 2, 1, GL_INT, sizeof(InstanceData),
+                           (void*) offsetof(InstanceData, layer));
+
+    // Advance once per instance instead of once per vertex
+    for (GLuint i = 0; i < 3; i++)
+    {
+        glEnableVertexAttribArray(firstLocation + i);
+        glVertexAttribDivisor(firstLocation + i, 1);
+    }
+
+    GLState::bindVertexArray(0);
+}
+
+InstancedMesh::~InstancedMesh()
+{
+    GLState::deleteBuffers(1, &_instanceBuffer);
+}
+
+void InstancedMesh::setInstances(const InstanceData* instances, size_t count)
+{
+    GLsizeiptr bytes = count * sizeof(InstanceData);
+
+    GLState::bindBuffer(GL_ARRAY_BUFFER, _instanceBuffer);
+    if (bytes > _capacity)
+        _capacity = bytes;
+    glBufferData(GL_ARRAY_BUFFER, _capacity, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, instances);
+
+    _instanceCount = (GLsizei) count;
+}
+
+void InstancedMesh::draw() const
+{
+    if (_instanceCount == 0)
+        return;
+
+    GLState::bindVertexArray(_vao);
+    glDrawElementsInstanced(GL_TRIANGLES, _indexCount, _indexType, 0, _instanceCount);
+}
@@ -0,0 +1,58 @@
+#ifndef INSTANCED_MESH_H_
+#define INSTANCED_MESH_H_
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// Per-instance attributes, read once per instance (divisor 1). With the
+// default first location of 3 they arrive in the vertex shader as
+//
+//     layout (location = 3) in vec4 iOffsetScale; // xyz offset, w uniform scale
+//     layout (location = 4) in vec3 iColor;
+//     layout (location = 5) in int iLayer;        // for a sampler2DArray
+struct InstanceData
+{
+    float offset[3];
+    float scale;
+    float color[3];
+    GLint layer;
+};
+
+// Draws N copies of an indexed mesh in one glDrawElementsInstanced call.
+// The mesh keeps its own VAO, VBO and EBO; this adds an instance buffer to
+// that VAO behind the mesh's attributes.
+//
+//     InstancedMesh quads { VAO, 6 };
+//     quads.setInstances(instances.data(), instances.size());
+//     shader.use();
+//     quads.draw();
+class InstancedMesh
+{
+    GLuint _vao;
+    GLsizei _indexCount;
+    GLenum _indexType;
+    GLuint _instanceBuffer;
+    GLsizeiptr _capacity = 0;
+    GLsizei _instanceCount = 0;
+
+    public:
+        // vao must already have its vertex attributes and element buffer
+        // set up; firstLocation is where the instance attributes start
+        InstancedMesh(GLuint vao, GLsizei indexCount, GLenum indexType = GL_UNSIGNED_INT, GLuint firstLocation = 3);
+        ~InstancedMesh();
+
+        InstancedMesh(const InstancedMesh&) = delete;
+        InstancedMesh& operator=(const InstancedMesh&) = delete;
+
+        // Replaces every instance. The buffer is orphaned first, so this
+        // can run every frame without waiting on the last frame's draw.
+        void setInstances(const InstanceData* instances, size_t count);
+
+        // Binds the VAO and draws every instance
+        void draw() const;
+
+        GLsizei instanceCount() const { return _instanceCount; }
+};
+
+#endif // INSTANCED_MESH_H_
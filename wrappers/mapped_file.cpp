@@ -0,0 +1,64 @@
+#include "mapped_file.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+MappedFile::MappedFile(const char* path, bool populate)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    struct stat info;
+    if (fstat(fd, &info) == 0)
+    {
+        _size = (size_t) info.st_size;
+        if (_size == 0)
+        {
+            _valid = true;
+        }
+        else
+        {
+            int flags = MAP_PRIVATE | (populate ? MAP_POPULATE : 0);
+            void* data = mmap(nullptr, _size, PROT_READ, flags, fd, 0);
+            if (data != MAP_FAILED)
+            {
+                _data = data;
+                _valid = true;
+            }
+        }
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : _data(std::exchange(other._data, nullptr)),
+      _size(std::exchange(other._size, 0)),
+      _valid(std::exchange(other._valid, false))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile &&other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        _data = std::exchange(other._data, nullptr);
+        _size = std::exchange(other._size, 0);
+        _valid = std::exchange(other._valid, false);
+    }
+    return *this;
+}
+
+void MappedFile::release()
+{
+    if (_data)
+        munmap(_data, _size);
+    _data = nullptr;
+    _size = 0;
+    _valid = false;
+}
@@ -0,0 +1,37 @@
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <cstddef>
+
+// Read-only memory mapping of a whole file. The contents can be handed
+// straight to GL (or anything else) without copying them into a buffer.
+class MappedFile
+{
+    void* _data = nullptr;
+    size_t _size = 0;
+    bool _valid = false;
+
+    void release();
+
+    public:
+        MappedFile() = default;
+
+        // populate asks the kernel to read the whole file in up front
+        // (MAP_POPULATE), so later accesses don't page fault
+        explicit MappedFile(const char* path, bool populate = false);
+        ~MappedFile() { release(); }
+
+        MappedFile(MappedFile &&other) noexcept;
+        MappedFile& operator=(MappedFile &&other) noexcept;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        // False if the file couldn't be opened or mapped.
+        // An empty file is valid, with a null data().
+        bool valid() const { return _valid; }
+
+        const unsigned char* data() const { return (const unsigned char*) _data; }
+        size_t size() const { return _size; }
+};
+
+#endif // MAPPED_FILE_H_
@@ -0,0 +1,297 @@
+#include "mesh_quantizer.hpp"
+#include "shader.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <utility>
+
+namespace
+{
+    const char fileMagic[4] = { 'Q', 'M', 'S', '1' };
+    const std::uint32_t fileVersion = 1;
+
+    // Value in [offset, offset + scale] to 0..65535
+    std::uint16_t quantize16(float value, float offset, float scale)
+    {
+        if (scale <= 0.0f)
+            return 0;
+        float fraction = std::min(std::max((value - offset) / scale, 0.0f), 1.0f);
+        return (std::uint16_t) std::lround(fraction * 65535.0f);
+    }
+
+    float decode16(std::uint16_t value, float offset, float scale)
+    {
+        return offset + (value / 65535.0f) * scale;
+    }
+
+    // OBJ indices start at 1, negative ones count back from the end
+    long resolveObjIndex(long index, size_t count)
+    {
+        return index < 0 ? (long) count + index : index - 1;
+    }
+}
+
+bool MeshQuantizer::loadObj(const char* path, std::vector<BatchVertex> &vertices, std::vector<GLuint> &indices)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cout << "ERROR::MESH_QUANTIZER::FAILED_OPEN\n" << path << std::endl;
+        return false;
+    }
+
+    std::vector<vertex::vec3> positions;
+    std::vector<vertex::vec3> colors;
+    std::vector<vertex::vec2> texCoords;
+    std::map<std::pair<long, long>, GLuint> corners; // (position, texCoord) -> vertex
+
+    std::string line;
+    for (size_t lineNumber = 1; std::getline(file, line); lineNumber++)
+    {
+        std::istringstream stream(line);
+        std::string type;
+        stream >> type;
+
+        if (type == "v")
+        {
+            vertex::vec3 position = {}, color = { 1.0f, 1.0f, 1.0f };
+            stream >> position.x >> position.y >> position.z;
+            if (!(stream >> color.x >> color.y >> color.z))
+                color = { 1.0f, 1.0f, 1.0f };
+            positions.push_back(position);
+            colors.push_back(color);
+        }
+        else if (type == "vt")
+        {
+            vertex::vec2 texCoord = {};
+            stream >> texCoord.x >> texCoord.y;
+            texCoords.push_back(texCoord);
+        }
+        else if (type == "f")
+        {
+            std::vector<GLuint> face;
+            std::string corner;
+            while (stream >> corner)
+            {
+                long position = resolveObjIndex(std::strtol(corner.c_str(), nullptr, 10), positions.size());
+                size_t slash = corner.find('/');
+                bool hasTexCoord = slash != std::string::npos && slash + 1 < corner.size() && corner[slash + 1] != '/';
+                long texCoord = hasTexCoord
+                    ? resolveObjIndex(std::strtol(corner.c_str() + slash + 1, nullptr, 10), texCoords.size())
+                    : -1;
+
+                // -1 is "none" only when the corner didn't name one
+                if (position < 0 || position >= (long) positions.size()
+                    || (hasTexCoord && (texCoord < 0 || texCoord >= (long) texCoords.size())))
+                {
+                    std::cout << "ERROR::MESH_QUANTIZER::OBJ_INDEX_OUT_OF_RANGE\n" << path << ":" << lineNumber
+                              << ": " << corner << std::endl;
+                    return false;
+                }
+
+                auto found = corners.find({ position, texCoord });
+                if (found == corners.end())
+                {
+                    BatchVertex v;
+                    v.position = positions[position];
+                    v.color = colors[position];
+                    v.texCoord = texCoord >= 0 ? texCoords[texCoord] : vertex::vec2{ 0.0f, 0.0f };
+                    vertices.push_back(v);
+                    found = corners.insert({ { position, texCoord }, (GLuint) vertices.size() - 1 }).first;
+                }
+                face.push_back(found->second);
+            }
+
+            for (size_t i = 2; i < face.size(); i++)
+                indices.insert(indices.end(), { face[0], face[i - 1], face[i] });
+        }
+    }
+    return true;
+}
+
+QuantizedMesh MeshQuantizer::quantize(const BatchVertex* vertices, size_t vertexCount,
+                                      const GLuint* indices, size_t indexCount)
+{
+    QuantizedMesh mesh;
+    mesh.indices.assign(indices, indices + indexCount);
+    mesh.decode = {};
+    if (vertexCount == 0)
+        return mesh;
+
+    vertex::vec3 low = vertices[0].position, high = vertices[0].position;
+    vertex::vec2 uvLow = vertices[0].texCoord, uvHigh = vertices[0].texCoord;
+    for (size_t i = 1; i < vertexCount; i++)
+    {
+        const BatchVertex &v = vertices[i];
+        low = { std::min(low.x, v.position.x), std::min(low.y, v.position.y), std::min(low.z, v.position.z) };
+        high = { std::max(high.x, v.position.x), std::max(high.y, v.position.y), std::max(high.z, v.position.z) };
+        uvLow = { std::min(uvLow.x, v.texCoord.x), std::min(uvLow.y, v.texCoord.y) };
+        uvHigh = { std::max(uvHigh.x, v.texCoord.x), std::max(uvHigh.y, v.texCoord.y) };
+    }
+
+    MeshDecode &decode = mesh.decode;
+    decode.positionOffset = low;
+    decode.positionScale = { high.x - low.x, high.y - low.y, high.z - low.z };
+    decode.texCoordOffset = uvLow;
+    decode.texCoordScale = { uvHigh.x - uvLow.x, uvHigh.y - uvLow.y };
+
+    mesh.vertices.resize(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        const BatchVertex &v = vertices[i];
+        QuantizedVertex &q = mesh.vertices[i];
+        q.position = {
+            quantize16(v.position.x, decode.positionOffset.x, decode.positionScale.x),
+            quantize16(v.position.y, decode.positionOffset.y, decode.positionScale.y),
+            quantize16(v.position.z, decode.positionOffset.z, decode.positionScale.z),
+            0
+        };
+        q.color = vertex::packUnorm8x4(v.color.x, v.color.y, v.color.z);
+        q.texCoord = {
+            quantize16(v.texCoord.x, decode.texCoordOffset.x, decode.texCoordScale.x),
+            quantize16(v.texCoord.y, decode.texCoordOffset.y, decode.texCoordScale.y)
+        };
+    }
+    return mesh;
+}
+
+BatchVertex MeshQuantizer::decode(const QuantizedVertex &vertex, const MeshDecode &decode)
+{
+    BatchVertex v;
+    v.position = {
+        decode16(vertex.position.x, decode.positionOffset.x, decode.positionScale.x),
+        decode16(vertex.position.y, decode.positionOffset.y, decode.positionScale.y),
+        decode16(vertex.position.z, decode.positionOffset.z, decode.positionScale.z)
+    };
+    v.color = { vertex.color.x / 255.0f, vertex.color.y / 255.0f, vertex.color.z / 255.0f };
+    v.texCoord = {
+        decode16(vertex.texCoord.x, decode.texCoordOffset.x, decode.texCoordScale.x),
+        decode16(vertex.texCoord.y, decode.texCoordOffset.y, decode.texCoordScale.y)
+    };
+    return v;
+}
+
+QuantizationError MeshQuantizer::measure(const BatchVertex* original, const QuantizedMesh &mesh)
+{
+    QuantizationError error;
+    double squares = 0.0;
+    for (size_t i = 0; i < mesh.vertices.size(); i++)
+    {
+        const BatchVertex &a = original[i];
+        BatchVertex b = decode(mesh.vertices[i], mesh.decode);
+
+        float dx = a.position.x - b.position.x, dy = a.position.y - b.position.y, dz = a.position.z - b.position.z;
+        float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+        error.maxPosition = std::max(error.maxPosition, distance);
+        squares += (double) distance * distance;
+
+        error.maxTexCoord = std::max({ error.maxTexCoord, std::fabs(a.texCoord.x - b.texCoord.x),
+                                       std::fabs(a.texCoord.y - b.texCoord.y) });
+        error.maxColor = std::max({ error.maxColor, std::fabs(a.color.x - b.color.x),
+                                    std::fabs(a.color.y - b.color.y), std::fabs(a.color.z - b.color.z) });
+    }
+    if (!mesh.vertices.empty())
+        error.rmsPosition = (float) std::sqrt(squares / mesh.vertices.size());
+    return error;
+}
+
+std::string MeshQuantizer::decodeGLSL()
+{
+    return
+        "// Quantized mesh decoding, generated by MeshQuantizer::decodeGLSL()\n"
+        "layout (location = 0) in vec4 aQuantizedPosition;\n"
+        "layout (location = 1) in vec4 aQuantizedColor;\n"
+        "layout (location = 2) in vec2 aQuantizedTexCoord;\n"
+        "\n"
+        "uniform vec3 meshPositionOffset;\n"
+        "uniform vec3 meshPositionScale;\n"
+        "uniform vec2 meshTexCoordOffset;\n"
+        "uniform vec2 meshTexCoordScale;\n"
+        "\n"
+        "vec3 decodePosition()\n"
+        "{\n"
+        "    return meshPositionOffset + aQuantizedPosition.xyz * meshPositionScale;\n"
+        "}\n"
+        "\n"
+        "vec3 decodeColor()\n"
+        "{\n"
+        "    return aQuantizedColor.rgb;\n"
+        "}\n"
+        "\n"
+        "vec2 decodeTexCoord()\n"
+        "{\n"
+        "    return meshTexCoordOffset + aQuantizedTexCoord * meshTexCoordScale;\n"
+        "}\n";
+}
+
+void MeshQuantizer::setDecodeUniforms(const Shader &shader, const MeshDecode &decode)
+{
+    glUniform3fv(shader.uniform("meshPositionOffset"_u).location, 1, &decode.positionOffset.x);
+    glUniform3fv(shader.uniform("meshPositionScale"_u).location, 1, &decode.positionScale.x);
+    glUniform2fv(shader.uniform("meshTexCoordOffset"_u).location, 1, &decode.texCoordOffset.x);
+    glUniform2fv(shader.uniform("meshTexCoordScale"_u).location, 1, &decode.texCoordScale.x);
+}
+
+QuantizedMeshFile::QuantizedMeshFile(const char* path)
+    : _file(path, true)
+{
+    if (!_file.valid() || _file.size() < sizeof(QuantizedMeshHeader))
+        return;
+
+    const QuantizedMeshHeader* header = (const QuantizedMeshHeader*) _file.data();
+    if (std::memcmp(header->magic, fileMagic, 4) != 0 || header->version != fileVersion)
+    {
+        std::cout << "ERROR::QUANTIZED_MESH_FILE::BAD_HEADER\n" << path << std::endl;
+        return;
+    }
+
+    std::uint64_t size = sizeof(QuantizedMeshHeader) + (std::uint64_t) header->vertexCount * sizeof(QuantizedVertex)
+                       + (std::uint64_t) header->indexCount * sizeof(GLuint);
+    if (size > _file.size())
+    {
+        std::cout << "ERROR::QUANTIZED_MESH_FILE::TRUNCATED\n" << path << std::endl;
+        return;
+    }
+
+    // Draws would read past the vertex buffer otherwise. One pass over the
+    // indices at load, still no copy.
+    const GLuint* indices = (const GLuint*) ((const QuantizedVertex*) (header + 1) + header->vertexCount);
+    for (std::uint32_t i = 0; i < header->indexCount; i++)
+    {
+        if (indices[i] >= header->vertexCount)
+        {
+            std::cout << "ERROR::QUANTIZED_MESH_FILE::BAD_INDEX\n" << path << ": index " << i << " is "
+                      << indices[i] << ", with " << header->vertexCount << " vertices" << std::endl;
+            return;
+        }
+    }
+
+    _header = header;
+}
+
+void QuantizedMeshFile::upload() const
+{
+    glBufferData(GL_ARRAY_BUFFER, _header->vertexCount * sizeof(QuantizedVertex), vertices(), GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, _header->indexCount * sizeof(GLuint), indices(), GL_STATIC_DRAW);
+}
+
+bool QuantizedMeshFile::write(const char* path, const QuantizedMesh &mesh)
+{
+    QuantizedMeshHeader header = {};
+    std::memcpy(header.magic, fileMagic, 4);
+    header.version = fileVersion;
+    header.vertexCount = (std::uint32_t) mesh.vertices.size();
+    header.indexCount = (std::uint32_t) mesh.indices.size();
+    header.decode = mesh.decode;
+
+    std::ofstream file(path, std::ios::binary);
+    file.write((const char*) &header, sizeof(header));
+    file.write((const char*) mesh.vertices.data(), mesh.vertices.size() * sizeof(QuantizedVertex));
+    file.write((const char*) mesh.indices.data(), mesh.indices.size() * sizeof(GLuint));
+    return (bool) file;
+}
@@ -0,0 +1,130 @@
+#ifndef MESH_QUANTIZER_H_
+#define MESH_QUANTIZER_H_
+
+#include "batch_renderer.hpp"
+#include "mapped_file.hpp"
+#include "vertex_layout.hpp"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Shader;
+
+// A BatchVertex in 16 bytes instead of 32. Position and texture coords are
+// 16-bit fractions of the mesh's bounding box (and texture coord range),
+// color is 8 bits a channel. Attribute locations match BatchVertex.
+struct QuantizedVertex
+{
+    vertex::unorm16x4 position; // w unused
+    vertex::unorm8x4 color;
+    vertex::unorm16x2 texCoord;
+};
+typedef VertexLayout<vertex::unorm16x4, vertex::unorm8x4, vertex::unorm16x2> QuantizedVertexLayout;
+VERTEX_ATTRIBUTE(QuantizedVertexLayout, QuantizedVertex, 0, position);
+VERTEX_ATTRIBUTE(QuantizedVertexLayout, QuantizedVertex, 1, color);
+VERTEX_ATTRIBUTE(QuantizedVertexLayout, QuantizedVertex, 2, texCoord);
+
+// GL reads a quantized value as 0..1; the mesh's value is offset + that * scale
+struct MeshDecode
+{
+    vertex::vec3 positionOffset;
+    vertex::vec3 positionScale;
+    vertex::vec2 texCoordOffset;
+    vertex::vec2 texCoordScale;
+};
+
+struct QuantizedMesh
+{
+    std::vector<QuantizedVertex> vertices;
+    std::vector<GLuint> indices;
+    MeshDecode decode;
+};
+
+// Worst and RMS difference between a mesh and its quantized version.
+// Position and texture coords are in the mesh's own units, color in 0..1.
+struct QuantizationError
+{
+    float maxPosition = 0.0f;
+    float rmsPosition = 0.0f;
+    float maxTexCoord = 0.0f;
+    float maxColor = 0.0f;
+};
+
+// Compresses meshes at runtime, or offline into .qmesh files with
+// tools/meshbake. A shader reads the result through decodeGLSL():
+//
+//     #version 330 core
+//     #include "mesh_decode.glsl"   // written by meshbake --glsl
+//     void main()
+//     {
+//         gl_Position = vec4(decodePosition(), 1.0);
+//         ...decodeColor(), decodeTexCoord()
+//     }
+//
+// and the mesh's MeshDecode set with setDecodeUniforms().
+class MeshQuantizer
+{
+    public:
+        // Reads a Wavefront .obj into a mesh: v (with an optional r g b
+        // after x y z), vt and f. Faces with more than three corners are
+        // split into fans, corners missing a texture coord get (0, 0).
+        // False if the file can't be read or a face indexes past the
+        // positions or texture coords it has (already reported).
+        static bool loadObj(const char* path, std::vector<BatchVertex> &vertices, std::vector<GLuint> &indices);
+
+        static QuantizedMesh quantize(const BatchVertex* vertices, size_t vertexCount,
+                                      const GLuint* indices, size_t indexCount);
+
+        // What decoding gives back, the way the shader does it
+        static BatchVertex decode(const QuantizedVertex &vertex, const MeshDecode &decode);
+
+        static QuantizationError measure(const BatchVertex* original, const QuantizedMesh &mesh);
+
+        // The vertex shader inputs, decode uniforms and decode functions
+        static std::string decodeGLSL();
+
+        // On the shader in use
+        static void setDecodeUniforms(const Shader &shader, const MeshDecode &decode);
+};
+
+// Quantized mesh container (.qmesh), written offline by tools/meshbake:
+//
+//     QuantizedMeshHeader | vertices | indices (GLuint)
+//
+// Loading is an mmap, and upload() hands both arrays straight to GL.
+struct QuantizedMeshHeader
+{
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t vertexCount;
+    std::uint32_t indexCount;
+    MeshDecode decode;
+};
+
+class QuantizedMeshFile
+{
+    MappedFile _file;
+    const QuantizedMeshHeader* _header = nullptr;
+
+    public:
+        QuantizedMeshFile() = default;
+
+        // Maps and validates the file, check valid() afterwards
+        explicit QuantizedMeshFile(const char* path);
+
+        bool valid() const { return _header != nullptr; }
+        const QuantizedMeshHeader& header() const { return *_header; }
+        const QuantizedVertex* vertices() const { return (const QuantizedVertex*) (_header + 1); }
+        const GLuint* indices() const { return (const GLuint*) (vertices() + _header->vertexCount); }
+
+        // glBufferData both arrays into the buffers bound to GL_ARRAY_BUFFER
+        // and GL_ELEMENT_ARRAY_BUFFER
+        void upload() const;
+
+        static bool write(const char* path, const QuantizedMesh &mesh);
+};
+
+#endif // MESH_QUANTIZER_H_
@@ -0,0 +1,445 @@
+#include "mipmap.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MIPMAP_X86 1
+#endif
+
+namespace
+{
+    // Averages source rows row0/row1 into one destination row
+    typedef void (*BoxRowKernel)(const unsigned char* row0, const unsigned char* row1, unsigned char* out,
+                                 int srcWidth, int dstWidth, int channels);
+
+    // Scalar reference. The SIMD kernels use it for their leftover columns.
+    void boxRowScalar(const unsigned char* row0, const unsigned char* row1, unsigned char* out,
+                      int srcWidth, int dstWidth, int channels, int startX)
+    {
+        for (int x = startX; x < dstWidth; x++)
+        {
+            int x0 = std::min(2 * x, srcWidth - 1) * channels;
+            int x1 = std::min(2 * x + 1, srcWidth - 1) * channels;
+            for (int c = 0; c < channels; c++)
+                out[x * channels + c] = (unsigned char) ((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+        }
+    }
+
+    void boxRowReference(const unsigned char* row0, const unsigned char* row1, unsigned char* out,
+                         int srcWidth, int dstWidth, int channels)
+    {
+        boxRowScalar(row0, row1, out, srcWidth, dstWidth, channels, 0);
+    }
+
+    // Horizontal half of the box filter, over rows already summed vertically
+    void boxRowFromSums(const std::uint16_t* sums, unsigned char* out, int srcWidth, int dstWidth, int channels)
+    {
+        for (int x = 0; x < dstWidth; x++)
+        {
+            int x0 = std::min(2 * x, srcWidth - 1) * channels;
+            int x1 = std::min(2 * x + 1, srcWidth - 1) * channels;
+            for (int c = 0; c < channels; c++)
+                out[x * channels + c] = (unsigned char) ((sums[x0 + c] + sums[x1 + c] + 2) / 4);
+        }
+    }
+
+#ifdef MIPMAP_X86
+    // RGBA8: 4 source pixels in, 2 out per iteration. Everything else
+    // (RGB8 mostly) sums the two rows in SIMD and finishes horizontally in
+    // scalar code, since 3-byte pixels don't line up with the lanes.
+    void boxRowSSE2(const unsigned char* row0, const unsigned char* row1, unsigned char* out,
+                    int srcWidth, int dstWidth, int channels)
+    {
+        const __m128i zero = _mm_setzero_si128();
+
+        if (channels == 4)
+        {
+            const __m128i two = _mm_set1_epi16(2);
+            int x = 0;
+            for (; 2 * x + 3 < srcWidth && x + 1 < dstWidth; x += 2)
+            {
+                __m128i a = _mm_loadu_si128((const __m128i*) (row0 + 8 * x));
+                __m128i b = _mm_loadu_si128((const __m128i*) (row1 + 8 * x));
+
+                // Vertical sums as 16 bits: lo holds pixels 0-1, hi pixels 2-3
+                __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+                __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+                // Horizontal: fold each pixel pair into the low 64 bits
+                lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+                hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+
+                __m128i sum = _mm_unpacklo_epi64(lo, hi);
+                sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+                _mm_storel_epi64((__m128i*) (out + 4 * x), _mm_packus_epi16(sum, sum));
+            }
+            boxRowScalar(row0, row1, out, srcWidth, dstWidth, channels, x);
+            return;
+        }
+
+        thread_local std::vector<std::uint16_t> sums;
+        int bytes = srcWidth * channels;
+        sums.resize(bytes);
+
+        int i = 0;
+        for (; i + 16 <= bytes; i += 16)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i*) (row0 + i));
+            __m128i b = _mm_loadu_si128((const __m128i*) (row1 + i));
+            _mm_storeu_si128((__m128i*) &sums[i], _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)));
+            _mm_storeu_si128((__m128i*) &sums[i + 8], _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)));
+        }
+        for (; i < bytes; i++)
+            sums[i] = row0[i] + row1[i];
+
+        boxRowFromSums(sums.data(), out, srcWidth, dstWidth, channels);
+    }
+
+    // Same layout as the SSE2 kernel, twice as wide. Unpacks work per
+    // 128-bit lane, so the results come out as qwords 0 and 2.
+    __attribute__((target("avx2")))
+    void boxRowAVX2(const unsigned char* row0, const unsigned char* row1, unsigned char* out,
+                    int srcWidth, int dstWidth, int channels)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+
+        if (channels == 4)
+        {
+            const __m256i two = _mm256_set1_epi16(2);
+            int x = 0;
+            for (; 2 * x + 7 < srcWidth && x + 3 < dstWidth; x += 4)
+            {
+                __m256i a = _mm256_loadu_si256((const __m256i*) (row0 + 8 * x));
+                __m256i b = _mm256_loadu_si256((const __m256i*) (row1 + 8 * x));
+
+                __m256i lo = _mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero));
+                __m256i hi = _mm256_add_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero));
+
+                lo = _mm256_add_epi16(lo, _mm256_srli_si256(lo, 8));
+                hi = _mm256_add_epi16(hi, _mm256_srli_si256(hi, 8));
+
+                __m256i sum = _mm256_unpacklo_epi64(lo, hi);
+                sum = _mm256_srli_epi16(_mm256_add_epi16(sum, two), 2);
+                __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(sum, sum), 0x08);
+                _mm_storeu_si128((__m128i*) (out + 4 * x), _mm256_castsi256_si128(packed));
+            }
+            boxRowScalar(row0, row1, out, srcWidth, dstWidth, channels, x);
+            return;
+        }
+
+        thread_local std::vector<std::uint16_t> sums;
+        int bytes = srcWidth * channels;
+        sums.resize(bytes);
+
+        int i = 0;
+        for (; i + 32 <= bytes; i += 32)
+        {
+            __m256i a = _mm256_loadu_si256((const __m256i*) (row0 + i));
+            __m256i b = _mm256_loadu_si256((const __m256i*) (row1 + i));
+            __m256i lo = _mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero));
+            __m256i hi = _mm256_add_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero));
+
+            // Undo the per-lane interleave so sums stay in byte order
+            _mm256_storeu_si256((__m256i*) &sums[i], _mm256_permute2x128_si256(lo, hi, 0x20));
+            _mm256_storeu_si256((__m256i*) &sums[i + 16], _mm256_permute2x128_si256(lo, hi, 0x31));
+        }
+        for (; i < bytes; i++)
+            sums[i] = row0[i] + row1[i];
+
+        boxRowFromSums(sums.data(), out, srcWidth, dstWidth, channels);
+    }
+#endif
+
+    BoxRowKernel selectBoxKernel(bool simd)
+    {
+#ifdef MIPMAP_X86
+        if (simd)
+            return __builtin_cpu_supports("avx2") ? boxRowAVX2 : boxRowSSE2;
+#endif
+        (void) simd;
+        return boxRowReference;
+    }
+
+    // sRGB transfer tables: 8-bit encoded to linear float, and linear
+    // quantized to 12 bits back to 8-bit encoded
+    struct SrgbTables
+    {
+        float toLinear[256];
+        unsigned char fromLinear[4096];
+
+        SrgbTables()
+        {
+            for (int i = 0; i < 256; i++)
+            {
+                float c = i / 255.0f;
+                toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+            for (int i = 0; i < 4096; i++)
+            {
+                float l = i / 4095.0f;
+                float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+                fromLinear[i] = (unsigned char) std::lround(std::clamp(c, 0.0f, 1.0f) * 255.0f);
+            }
+        }
+
+        unsigned char encode(float linear) const
+        {
+            return fromLinear[(int) (std::clamp(linear, 0.0f, 1.0f) * 4095.0f + 0.5f)];
+        }
+    };
+
+    const SrgbTables& srgbTables()
+    {
+        static const SrgbTables tables;
+        return tables;
+    }
+
+    // Which channels carry color: RGB of RGB/RGBA, the first of R/RG
+    int colorChannels(int channels)
+    {
+        return channels >= 3 ? 3 : 1;
+    }
+
+    void boxRowSrgb(const unsigned char* row0, const unsigned char* row1, unsigned char* out,
+                    int srcWidth, int dstWidth, int channels)
+    {
+        const SrgbTables &srgb = srgbTables();
+        int colors = colorChannels(channels);
+
+        for (int x = 0; x < dstWidth; x++)
+        {
+            int x0 = std::min(2 * x, srcWidth - 1) * channels;
+            int x1 = std::min(2 * x + 1, srcWidth - 1) * channels;
+            for (int c = 0; c < channels; c++)
+            {
+                if (c < colors)
+                {
+                    float sum = srgb.toLinear[row0[x0 + c]] + srgb.toLinear[row0[x1 + c]]
+                              + srgb.toLinear[row1[x0 + c]] + srgb.toLinear[row1[x1 + c]];
+                    out[x * channels + c] = srgb.encode(sum * 0.25f);
+                }
+                else
+                    out[x * channels + c] = (unsigned char) ((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+            }
+        }
+    }
+
+    // The kernels average 2x2 blocks, which leaves the last column and row
+    // of an odd-sized level out. Like GL's box filter, the last texels take
+    // them in instead, averaging 2x3, 3x2 or 3x3 pixels.
+    void boxEdgeTexel(const unsigned char* src, int srcWidth, int srcHeight, MipLevel &dst, int x, int y,
+                      int channels, bool srgb)
+    {
+        const SrgbTables &tables = srgbTables();
+        int colors = srgb ? colorChannels(channels) : 0;
+
+        int x0 = 2 * x, x1 = x == dst.width - 1 ? srcWidth - 1 : 2 * x + 1;
+        int y0 = 2 * y, y1 = y == dst.height - 1 ? srcHeight - 1 : 2 * y + 1;
+        int count = (x1 - x0 + 1) * (y1 - y0 + 1);
+
+        for (int c = 0; c < channels; c++)
+        {
+            int sum = 0;
+            float linear = 0.0f;
+            for (int sy = y0; sy <= y1; sy++)
+            {
+                for (int sx = x0; sx <= x1; sx++)
+                {
+                    unsigned char v = src[((size_t) sy * srcWidth + sx) * channels + c];
+                    sum += v;
+                    linear += tables.toLinear[v];
+                }
+            }
+
+            dst.pixels[((size_t) y * dst.width + x) * channels + c] =
+                c < colors ? tables.encode(linear / count) : (unsigned char) ((sum + count / 2) / count);
+        }
+    }
+
+    // Levels this many pixels or bigger get split into bands
+    const int parallelThreshold = 256 * 256;
+    const int bandRows = 32;
+
+    template <typename Body>
+    void forEachBand(int rows, int levelPixels, ThreadPool* pool, const Body &body)
+    {
+        if (!pool || levelPixels < parallelThreshold)
+        {
+            body(0, rows);
+            return;
+        }
+
+        size_t bands = (rows + bandRows - 1) / bandRows;
+        pool->parallelFor(bands, [&](size_t band) {
+            int y0 = (int) band * bandRows;
+            body(y0, std::min(rows, y0 + bandRows));
+        });
+    }
+
+    void downsampleBox(const unsigned char* src, int srcWidth, int srcHeight, MipLevel &dst,
+                       int channels, const MipOptions &options)
+    {
+        BoxRowKernel kernel = options.srgb ? boxRowSrgb : selectBoxKernel(options.simd);
+        size_t srcStride = (size_t) srcWidth * channels;
+        size_t dstStride = (size_t) dst.width * channels;
+        bool oddColumn = srcWidth > 1 && srcWidth % 2 == 1;
+        bool oddRow = srcHeight > 1 && srcHeight % 2 == 1;
+
+        forEachBand(dst.height, dst.width * dst.height, options.pool, [&](int y0, int y1) {
+            for (int y = y0; y < y1; y++)
+            {
+                const unsigned char* row0 = src + std::min(2 * y, srcHeight - 1) * srcStride;
+                const unsigned char* row1 = src + std::min(2 * y + 1, srcHeight - 1) * srcStride;
+                kernel(row0, row1, &dst.pixels[y * dstStride], srcWidth, dst.width, channels);
+
+                if (oddRow && y == dst.height - 1)
+                {
+                    for (int x = 0; x < dst.width; x++)
+                        boxEdgeTexel(src, srcWidth, srcHeight, dst, x, y, channels, options.srgb);
+                }
+                else if (oddColumn)
+                    boxEdgeTexel(src, srcWidth, srcHeight, dst, dst.width - 1, y, channels, options.srgb);
+            }
+        });
+    }
+
+    // Kaiser-windowed sinc for 2:1 decimation. The destination pixel sits
+    // between source pixels 2x and 2x+1, so the 8 taps are at distances
+    // -3.5 ... 3.5 source pixels.
+    const int kaiserTaps = 8;
+
+    double besselI0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 32; k++)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    const float* kaiserWeights()
+    {
+        static const struct Weights
+        {
+            float w[kaiserTaps];
+
+            Weights()
+            {
+                const double pi = 3.14159265358979323846;
+                const double alpha = 4.0, radius = 4.0;
+                double total = 0.0;
+                for (int k = 0; k < kaiserTaps; k++)
+                {
+                    double d = k - 3.5;
+                    double sinc = std::sin(pi * d / 2.0) / (pi * d / 2.0);
+                    double t = d / radius;
+                    double window = besselI0(alpha * std::sqrt(1.0 - t * t)) / besselI0(alpha);
+                    w[k] = (float) (sinc * window);
+                    total += w[k];
+                }
+                for (int k = 0; k < kaiserTaps; k++)
+                    w[k] = (float) (w[k] / total);
+            }
+        } weights;
+        return weights.w;
+    }
+
+    void downsampleKaiser(const unsigned char* src, int srcWidth, int srcHeight, MipLevel &dst,
+                          int channels, const MipOptions &options)
+    {
+        const float* weights = kaiserWeights();
+        const SrgbTables &srgb = srgbTables();
+        int colors = options.srgb ? colorChannels(channels) : 0;
+
+        // Decode to linear floats, filter horizontally into (dstWidth x srcHeight),
+        // then vertically into the destination
+        std::vector<float> horizontal((size_t) dst.width * srcHeight * channels);
+
+        forEachBand(srcHeight, dst.width * srcHeight, options.pool, [&](int y0, int y1) {
+            for (int y = y0; y < y1; y++)
+            {
+                const unsigned char* row = src + (size_t) y * srcWidth * channels;
+                float* out = &horizontal[(size_t) y * dst.width * channels];
+                for (int x = 0; x < dst.width; x++)
+                {
+                    for (int c = 0; c < channels; c++)
+                    {
+                        float sum = 0.0f;
+                        for (int k = 0; k < kaiserTaps; k++)
+                        {
+                            int sx = std::clamp(2 * x - 3 + k, 0, srcWidth - 1);
+                            unsigned char v = row[sx * channels + c];
+                            sum += weights[k] * (c < colors ? srgb.toLinear[v] : v / 255.0f);
+                        }
+                        out[x * channels + c] = sum;
+                    }
+                }
+            }
+        });
+
+        forEachBand(dst.height, dst.width * dst.height, options.pool, [&](int y0, int y1) {
+            for (int y = y0; y < y1; y++)
+            {
+                unsigned char* out = &dst.pixels[(size_t) y * dst.width * channels];
+                for (int i = 0; i < dst.width * channels; i++)
+                {
+                    float sum = 0.0f;
+                    for (int k = 0; k < kaiserTaps; k++)
+                    {
+                        int sy = std::clamp(2 * y - 3 + k, 0, srcHeight - 1);
+                        sum += weights[k] * horizontal[(size_t) sy * dst.width * channels + i];
+                    }
+                    // The sinc lobes can overshoot, clamp back into range
+                    out[i] = (i % channels) < colors ? srgb.encode(sum)
+                           : (unsigned char) std::lround(std::clamp(sum, 0.0f, 1.0f) * 255.0f);
+                }
+            }
+        });
+    }
+}
+
+std::vector<MipLevel> buildMipLevels(const unsigned char* data, int width, int height, int channels,
+                                     const MipOptions &options)
+{
+    std::vector<MipLevel> levels;
+    const unsigned char* src = data;
+    int srcWidth = width, srcHeight = height;
+
+    while (srcWidth > 1 || srcHeight > 1)
+    {
+        MipLevel dst;
+        dst.width = std::max(1, srcWidth / 2);
+        dst.height = std::max(1, srcHeight / 2);
+        dst.pixels.resize((size_t) dst.width * dst.height * channels);
+
+        if (options.filter == MipFilter::Kaiser)
+            downsampleKaiser(src, srcWidth, srcHeight, dst, channels, options);
+        else
+            downsampleBox(src, srcWidth, srcHeight, dst, channels, options);
+
+        levels.push_back(std::move(dst));
+        src = levels.back().pixels.data();
+        srcWidth = levels.back().width;
+        srcHeight = levels.back().height;
+    }
+
+    return levels;
+}
+
+std::vector<MipLevel> buildMipChain(const unsigned char* data, int width, int height, int channels,
+                                    const MipOptions &options)
+{
+    std::vector<MipLevel> chain;
+    chain.push_back({ width, height, std::vector<unsigned char>(data, data + (size_t) width * height * channels) });
+
+    std::vector<MipLevel> levels = buildMipLevels(data, width, height, channels, options);
+    for (MipLevel &level : levels)
+        chain.push_back(std::move(level));
+
+    return chain;
+}
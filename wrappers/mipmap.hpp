@@ -0,0 +1,49 @@
+#ifndef MIPMAP_H_
+#define MIPMAP_H_
+
+#include <vector>
+
+class ThreadPool;
+
+// One level of a CPU-side mip chain, tightly packed 8-bit channels
+struct MipLevel
+{
+    int width;
+    int height;
+    std::vector<unsigned char> pixels;
+};
+
+enum class MipFilter
+{
+    Box,   // 2x2 average, what glGenerateMipmap does on most drivers
+    Kaiser // 8-tap Kaiser-windowed sinc, sharper and less aliasing
+};
+
+struct MipOptions
+{
+    MipFilter filter = MipFilter::Box;
+
+    // Average color channels in linear light instead of on the encoded
+    // values. Alpha (the 4th channel) is always linear.
+    bool srgb = false;
+
+    // SSE2/AVX2 kernels for the linear box filter. Turning this off gives
+    // the plain scalar reference, handy for checking and benchmarking.
+    bool simd = true;
+
+    // Splits big levels into row bands across the pool, when given
+    ThreadPool* pool = nullptr;
+};
+
+// Builds levels 1..N (down to 1x1) of an 8-bit image with 1 to 4 channels,
+// as returned by stb_image. Halving an odd dimension rounds down, and the
+// box filter folds the leftover last row/column into the last texels (as
+// GL's does); the Kaiser taps reach it anyway.
+std::vector<MipLevel> buildMipLevels(const unsigned char* data, int width, int height, int channels,
+                                     const MipOptions &options = MipOptions());
+
+// Same, with a copy of level 0 in front
+std::vector<MipLevel> buildMipChain(const unsigned char* data, int width, int height, int channels,
+                                    const MipOptions &options = MipOptions());
+
+#endif // MIPMAP_H_
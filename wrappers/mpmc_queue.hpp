@@ -0,0 +1,95 @@
+#ifndef MPMC_QUEUE_H_
+#define MPMC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// Bounded lock-free multi-producer/multi-consumer queue (Dmitry Vyukov's
+// design). Each cell carries a sequence number telling producers and
+// consumers whose turn it is, so push and pop are a single CAS on the fast
+// path. Capacity is rounded up to a power of two.
+template <typename T>
+class MPMCQueue
+{
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    // Keep the two indices on separate cache lines, producers and the
+    // consumer hammer different ends
+    alignas(64) std::atomic<size_t> _head{0};
+    alignas(64) std::atomic<size_t> _tail{0};
+    alignas(64) std::unique_ptr<Cell[]> _cells;
+    size_t _mask;
+
+    public:
+        explicit MPMCQueue(size_t capacity)
+        {
+            size_t size = 2;
+            while (size < capacity)
+                size *= 2;
+
+            _cells.reset(new Cell[size]);
+            _mask = size - 1;
+            for (size_t i = 0; i < size; i++)
+                _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        MPMCQueue(const MPMCQueue&) = delete;
+        MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+        // False if the queue is full
+        bool push(const T &value)
+        {
+            size_t pos = _tail.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                Cell &cell = _cells[pos & _mask];
+                size_t seq = cell.sequence.load(std::memory_order_acquire);
+                std::ptrdiff_t diff = (std::ptrdiff_t) seq - (std::ptrdiff_t) pos;
+                if (diff == 0)
+                {
+                    if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        cell.value = value;
+                        cell.sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (diff < 0)
+                    return false;
+                else
+                    pos = _tail.load(std::memory_order_relaxed);
+            }
+        }
+
+        // False if the queue is empty
+        bool pop(T &value)
+        {
+            size_t pos = _head.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                Cell &cell = _cells[pos & _mask];
+                size_t seq = cell.sequence.load(std::memory_order_acquire);
+                std::ptrdiff_t diff = (std::ptrdiff_t) seq - (std::ptrdiff_t) (pos + 1);
+                if (diff == 0)
+                {
+                    if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        value = cell.value;
+                        cell.sequence.store(pos + _mask + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (diff < 0)
+                    return false;
+                else
+                    pos = _head.load(std::memory_order_relaxed);
+            }
+        }
+};
+
+#endif // MPMC_QUEUE_H_
@@ -0,0 +1,113 @@
+#include "pixel_upload_ring.hpp"
+#include "gl_state.hpp"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+PixelUploadRing::PixelUploadRing(GLsizeiptr slotSize, size_t slotCount)
+{
+    // Keep every slot offset nicely aligned for the copy engine
+    _slotSize = (slotSize + 255) & ~(GLsizeiptr) 255;
+    for (size_t i = 0; i < slotCount; i++)
+        _slots.push_back({ (GLintptr) i * _slotSize, nullptr });
+
+    GLsizeiptr total = _slotSize * (GLsizeiptr) slotCount;
+
+    glGenBuffers(1, &_buffer);
+    GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, _buffer);
+
+    if (glBufferStorage)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, total, nullptr, flags);
+        _persistent = (unsigned char*) glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, total, flags);
+
+        // The storage allows plain write maps too, so uploads can still
+        // map their slot one at a time
+        if (!_persistent)
+            std::cout << "WARNING::PIXEL_UPLOAD_RING::PERSISTENT_MAP_FAILED\nMapping a slot per upload instead"
+                      << std::endl;
+    }
+    else
+    {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, total, nullptr, GL_STREAM_DRAW);
+    }
+
+    GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+PixelUploadRing::~PixelUploadRing()
+{
+    for (Slot &slot : _slots)
+        if (slot.fence)
+            glDeleteSync(slot.fence);
+
+    if (_persistent)
+    {
+        GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, _buffer);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    GLState::deleteBuffers(1, &_buffer);
+}
+
+void PixelUploadRing::texImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height,
+                                 GLenum format, GLenum type, const void* pixels, GLsizeiptr size)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    if (size > _slotSize)
+    {
+        glTexImage2D(target, level, internalFormat, width, height, 0, format, type, pixels);
+        _stats.fallbacks++;
+    }
+    else
+    {
+        Slot &slot = _slots[_next];
+        _next = (_next + 1) % _slots.size();
+
+        // Make sure the GPU finished reading this slot's last upload
+        if (slot.fence)
+        {
+            GLenum result = glClientWaitSync(slot.fence, 0, 0);
+            if (result == GL_TIMEOUT_EXPIRED)
+            {
+                _stats.stalls++;
+                glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+            }
+            glDeleteSync(slot.fence);
+            slot.fence = nullptr;
+        }
+
+        GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, _buffer);
+
+        if (_persistent)
+        {
+            std::memcpy(_persistent + slot.offset, pixels, size);
+        }
+        else
+        {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+            void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, slot.offset, size, flags);
+            if (!dst)
+            {
+                std::cout << "ERROR::PIXEL_UPLOAD_RING::MAP_FAILED\nSkipping a " << width << "x" << height
+                          << " upload" << std::endl;
+                GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                return;
+            }
+            std::memcpy(dst, pixels, size);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+
+        // With an unpack buffer bound, the pointer argument is an offset into it
+        glTexImage2D(target, level, internalFormat, width, height, 0, format, type, (const void*) slot.offset);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    _stats.bytes += size;
+    _stats.uploads++;
+    _stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,63 @@
+#ifndef PIXEL_UPLOAD_RING_H_
+#define PIXEL_UPLOAD_RING_H_
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <vector>
+
+// Streams texture uploads through a ring of pixel unpack buffer slots.
+// Pixels are copied into GPU-visible memory and glTexImage2D reads them from
+// the bound GL_PIXEL_UNPACK_BUFFER, so the driver doesn't make its own
+// synchronous copy of client memory. A fence per slot tells us when the GPU
+// is done reading it and the slot can be written again.
+//
+// On GL 4.4 (or ARB_buffer_storage) the buffer is mapped once, persistently.
+// Otherwise each upload maps its slot with GL_MAP_UNSYNCHRONIZED_BIT, which
+// is safe because the fence was already waited on.
+class PixelUploadRing
+{
+    struct Slot
+    {
+        GLintptr offset;
+        GLsync fence;
+    };
+
+    GLuint _buffer;
+    GLsizeiptr _slotSize;
+    std::vector<Slot> _slots;
+    size_t _next = 0;
+    unsigned char* _persistent = nullptr;
+
+    public:
+        struct Stats
+        {
+            unsigned long long bytes = 0;
+            unsigned uploads = 0;
+            unsigned fallbacks = 0; // too big for a slot, sent from client memory
+            unsigned stalls = 0;    // had to wait for the GPU to free a slot
+            double seconds = 0.0;   // CPU time spent inside upload()
+
+            double megabytesPerSecond() const { return seconds > 0.0 ? bytes / (1024.0 * 1024.0) / seconds : 0.0; }
+        };
+
+        explicit PixelUploadRing(GLsizeiptr slotSize = 8 << 20, size_t slotCount = 3);
+        ~PixelUploadRing();
+
+        PixelUploadRing(const PixelUploadRing&) = delete;
+        PixelUploadRing& operator=(const PixelUploadRing&) = delete;
+
+        // glTexImage2D into the texture bound to target, with the pixels
+        // staged through the ring. Uploads bigger than a slot fall back to
+        // a plain glTexImage2D from client memory.
+        void texImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height,
+                        GLenum format, GLenum type, const void* pixels, GLsizeiptr size);
+
+        bool persistent() const { return _persistent != nullptr; }
+        const Stats& stats() const { return _stats; }
+
+    private:
+        Stats _stats;
+};
+
+#endif // PIXEL_UPLOAD_RING_H_
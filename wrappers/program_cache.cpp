@@ -0,0 +1,180 @@
+#include "program_cache.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+    const char cacheMagic[4] = { 'L', 'G', 'P', 'B' };
+    const std::uint32_t cacheVersion = 1;
+
+    struct CacheHeader
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t format;
+        std::uint32_t length;
+    };
+
+    std::string cacheDirectory = ".shadercache";
+    ProgramCache::Stats cacheStats;
+
+    std::uint64_t fnv1a64(std::uint64_t hash, const char* data, size_t length)
+    {
+        for (size_t i = 0; i < length; i++)
+            hash = (hash ^ (unsigned char) data[i]) * 1099511628211ull;
+        return hash;
+    }
+
+    std::uint64_t fnv1a64(std::uint64_t hash, const GLubyte* str)
+    {
+        const char* s = str ? (const char*) str : "";
+        // Hash the terminator too, so ("ab", "c") and ("a", "bc") differ
+        return fnv1a64(hash, s, std::char_traits<char>::length(s) + 1);
+    }
+
+    // Same hash as the pieces joined into one string, terminator included
+    std::uint64_t fnv1a64(std::uint64_t hash, const ShaderSource &source)
+    {
+        for (GLsizei i = 0; i < source.count(); i++)
+            hash = fnv1a64(hash, source.strings()[i], source.lengths()[i]);
+        return fnv1a64(hash, "", 1);
+    }
+
+    std::string cachePath(const std::string &key)
+    {
+        return cacheDirectory + "/" + key + ".bin";
+    }
+}
+
+bool ProgramCache::supported()
+{
+    if (!glGetProgramBinary || !glProgramBinary)
+        return false;
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+void ProgramCache::setDirectory(const std::string &path)
+{
+    cacheDirectory = path;
+}
+
+std::string ProgramCache::key(const ShaderSource &vertexCode, const ShaderSource &fragCode)
+{
+    std::uint64_t hash = 14695981039346656037ull;
+    hash = fnv1a64(hash, glGetString(GL_VENDOR));
+    hash = fnv1a64(hash, glGetString(GL_RENDERER));
+    hash = fnv1a64(hash, glGetString(GL_VERSION));
+    hash = fnv1a64(hash, vertexCode);
+    hash = fnv1a64(hash, fragCode);
+
+    char buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%016llx", (unsigned long long) hash);
+    return buffer;
+}
+
+GLuint ProgramCache::load(const std::string &key)
+{
+    if (!supported())
+        return 0;
+
+    std::string path = cachePath(key);
+    std::ifstream file(path, std::ios::binary);
+    CacheHeader header;
+    if (!file || !file.read((char*) &header, sizeof(header))
+        || !std::equal(cacheMagic, cacheMagic + 4, header.magic)
+        || header.version != cacheVersion)
+    {
+        cacheStats.misses++;
+        return 0;
+    }
+
+    // The length is only the file's word for it, so hold it to the real
+    // size before allocating that much. Any difference means a torn or
+    // corrupt entry, which is dropped like a stale one.
+    std::error_code ec;
+    std::uintmax_t fileSize = std::filesystem::file_size(path, ec);
+    if (ec || fileSize != sizeof(header) + (std::uintmax_t) header.length)
+    {
+        file.close();
+        std::filesystem::remove(path, ec);
+        cacheStats.misses++;
+        return 0;
+    }
+
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), binary.size()))
+    {
+        cacheStats.misses++;
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.format, binary.data(), header.length);
+
+    // The driver is free to reject a binary (e.g. after an update that kept
+    // the version string), so treat that as a miss and drop the entry.
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glDeleteProgram(program);
+        std::filesystem::remove(path, ec);
+        cacheStats.stale++;
+        cacheStats.misses++;
+        return 0;
+    }
+
+    cacheStats.hits++;
+    return program;
+}
+
+void ProgramCache::store(const std::string &key, GLuint program)
+{
+    if (!supported())
+        return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum format;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+
+    std::error_code ec;
+    std::filesystem::create_directories(cacheDirectory, ec);
+
+    // Write to a temporary and rename, so a crash never leaves half a file
+    std::string path = cachePath(key);
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        CacheHeader header;
+        std::copy(cacheMagic, cacheMagic + 4, header.magic);
+        header.version = cacheVersion;
+        header.format = format;
+        header.length = (std::uint32_t) length;
+        file.write((const char*) &header, sizeof(header));
+        file.write(binary.data(), length);
+        if (!file)
+        {
+            std::cout << "WARNING::PROGRAM_CACHE::FAILED_WRITE\n" << tmpPath << std::endl;
+            return;
+        }
+    }
+    std::filesystem::rename(tmpPath, path, ec);
+}
+
+const ProgramCache::Stats& ProgramCache::stats()
+{
+    return cacheStats;
+}
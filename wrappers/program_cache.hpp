@@ -0,0 +1,41 @@
+#ifndef PROGRAM_CACHE_H_
+#define PROGRAM_CACHE_H_
+
+#include "shader_preprocessor.hpp"
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <string>
+
+// On-disk cache of linked program binaries (glGetProgramBinary/glProgramBinary).
+// Entries are keyed by a hash of the shader sources plus the driver's
+// vendor/renderer/version strings, so a driver update simply misses.
+// key(), load() and store() may also run on a worker thread with a shared
+// context current (ShaderReloader does), so set the directory up front.
+class ProgramCache
+{
+    public:
+        struct Stats
+        {
+            std::atomic<unsigned> hits{0};
+            std::atomic<unsigned> misses{0};
+            std::atomic<unsigned> stale{0}; // found on disk, but the driver rejected it
+        };
+
+        // True if the context exposes at least one program binary format
+        static bool supported();
+
+        // Where cache files live, relative to the working directory by default
+        static void setDirectory(const std::string &path);
+
+        static std::string key(const ShaderSource &vertexCode, const ShaderSource &fragCode);
+
+        // Returns a linked program, or 0 if there is no usable entry
+        static GLuint load(const std::string &key);
+        static void store(const std::string &key, GLuint program);
+
+        static const Stats& stats();
+};
+
+#endif // PROGRAM_CACHE_H_
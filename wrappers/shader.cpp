@@ -1,91 +1,211 @@
 #include "shader.hpp"
-#include <fstream>
-#include <sstream>
+#include "program_cache.hpp"
 #include <iostream>
 
-Shader::Shader(const char* vShaderPath, const char* fShaderPath)
+Shader::Shader(const char* vShaderPath, const char* fShaderPath, const ShaderDefines &defines)
+    : _vertexPath(vShaderPath), _fragPath(fShaderPath), _defines(defines)
 {
-    std::string vertexCode;
-    std::string fragCode;
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
+    ShaderSource vertexCode;
+    ShaderSource fragCode;
+    loadSources(vShaderPath, fShaderPath, defines, vertexCode, fragCode, &_sourceFiles);
 
-    // Setting exceptions
-    vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
-    try
+    // Try the on-disk binary cache before paying for a full compile
+    std::string cacheKey = ProgramCache::key(vertexCode, fragCode);
+    _handle = ProgramCache::load(cacheKey);
+    if (_handle == 0)
     {
-        vShaderFile.open(vShaderPath);
-        fShaderFile.open(fShaderPath);
+        _handle = compileProgram(vertexCode, fragCode);
+        if (_handle != 0)
+            ProgramCache::store(cacheKey, _handle);
+    }
 
-        std::stringstream vStream, fStream;
-        vStream << vShaderFile.rdbuf();
-        fStream << fShaderFile.rdbuf();
+    cacheUniforms();
+}
 
-        vShaderFile.close();
-        fShaderFile.close();
+Shader::Shader(GLuint program)
+    : _handle(program)
+{
+    cacheUniforms();
+}
 
-        vertexCode = vStream.str();
-        fragCode   = fStream.str();
-    }
-    catch (std::ifstream::failure e)
+bool Shader::loadSources(const char* vShaderPath, const char* fShaderPath, const ShaderDefines &defines,
+                         ShaderSource &vertexCode, ShaderSource &fragCode, std::vector<std::string>* files)
+{
+    if (!ShaderPreprocessor::process(vShaderPath, defines, vertexCode, files)
+        || !ShaderPreprocessor::process(fShaderPath, defines, fragCode, files))
     {
         std::cout << "ERROR::SHADER::FILE::FAILED_FILE_READ\nAre the shader files accessible?" << std::endl;
+        return false;
     }
 
-    GLuint vertex, frag;
+    return true;
+}
+
+GLuint Shader::compileProgram(const ShaderSource &vCode, const ShaderSource &fCode)
+{
+    return finishProgram(submitProgram(vCode, fCode));
+}
+
+Shader::PendingProgram Shader::submitProgram(const ShaderSource &vCode, const ShaderSource &fCode)
+{
+    // No status checks here: querying right after each step would force the
+    // driver to finish it, so everything is issued first and checked later.
+    PendingProgram pending;
+
+    pending.vertex = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(pending.vertex, vCode.count(), vCode.strings(), vCode.lengths());
+    glCompileShader(pending.vertex);
+
+    pending.frag = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(pending.frag, fCode.count(), fCode.strings(), fCode.lengths());
+    glCompileShader(pending.frag);
+
+    pending.program = glCreateProgram();
+    glAttachShader(pending.program, pending.vertex);
+    glAttachShader(pending.program, pending.frag);
+
+    // Ask the driver to keep the binary around so ProgramCache can save it
+    if (ProgramCache::supported())
+        glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+    glLinkProgram(pending.program);
+
+    return pending;
+}
+
+GLuint Shader::finishProgram(const PendingProgram &pending)
+{
     int success;
     char infoLog[512];
 
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    const char* vCode = vertexCode.data();
-    glShaderSource(vertex, 1, &vCode, NULL);
-    glCompileShader(vertex);
-    glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
+    glGetShaderiv(pending.vertex, GL_COMPILE_STATUS, &success);
     if (!success)
     {
-        glGetShaderInfoLog(vertex, 512, NULL, infoLog);
+        glGetShaderInfoLog(pending.vertex, 512, NULL, infoLog);
         std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
     }
 
-    frag = glCreateShader(GL_FRAGMENT_SHADER);
-    const char* fCode = fragCode.data();
-    glShaderSource(frag, 1, &fCode, NULL);
-    glCompileShader(frag);
-    glGetShaderiv(frag, GL_COMPILE_STATUS, &success);
+    glGetShaderiv(pending.frag, GL_COMPILE_STATUS, &success);
     if (!success)
     {
-        glGetShaderInfoLog(frag, 512, NULL, infoLog);
+        glGetShaderInfoLog(pending.frag, 512, NULL, infoLog);
         std::cout << "ERROR::SHADER::FRAG::COMPILATION_FAILED\n" << infoLog << std::endl;
     }
 
-    _handle = glCreateProgram();
-    glAttachShader(_handle, vertex);
-    glAttachShader(_handle, frag);
-    glLinkProgram(_handle);
-    glGetProgramiv(_handle, GL_LINK_STATUS, &success);
+    glGetProgramiv(pending.program, GL_LINK_STATUS, &success);
     if(!success) {
-        glGetProgramInfoLog(_handle, 512, NULL, infoLog);
+        glGetProgramInfoLog(pending.program, 512, NULL, infoLog);
         std::cout << "ERROR::SHADER::LINK::COMPILATION_FAILED\n" << infoLog << std::endl;
     }
 
-    glDeleteShader(vertex);
-    glDeleteShader(frag);
+    glDeleteShader(pending.vertex);
+    glDeleteShader(pending.frag);
+
+    if (!success)
+    {
+        glDeleteProgram(pending.program);
+        return 0;
+    }
+
+    return pending.program;
+}
+
+void Shader::replaceProgram(GLuint program)
+{
+    if (_handle != 0)
+        glDeleteProgram(_handle);
+    _handle = program;
+    cacheUniforms();
+}
+
+void Shader::cacheUniforms()
+{
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(_handle, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(_handle, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    // Every uniform takes at most two slots (arrays get a "[0]" alias),
+    // so this keeps the load factor at or below 1/2 and probes short
+    size_t size = 8;
+    while (size < (size_t) count * 4)
+        size *= 2;
+    _uniforms.assign(size, UniformSlot{});
+
+    std::string name(maxLength > 0 ? maxLength : 1, '\0');
+    for (GLint i = 0; i < count; i++)
+    {
+        GLsizei length = 0;
+        GLint arraySize;
+        GLenum type;
+        glGetActiveUniform(_handle, i, maxLength, &length, &arraySize, &type, &name[0]);
+
+        std::string uniformName = name.substr(0, length);
+        GLint location = glGetUniformLocation(_handle, uniformName.data());
+
+        // Uniform block members have no location
+        if (location == -1)
+            continue;
+
+        insertUniform(uniformName, location);
+
+        // Arrays are reported as "name[0]", but "name" is valid too
+        if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+            insertUniform(uniformName.substr(0, uniformName.size() - 3), location);
+    }
+}
+
+void Shader::insertUniform(const std::string &name, GLint location)
+{
+    std::uint32_t hash = uniformHash(name.data());
+    size_t mask = _uniforms.size() - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask)
+    {
+        if (_uniforms[i].name.empty())
+        {
+            _uniforms[i] = { hash, location, name };
+            return;
+        }
+    }
+}
+
+GLint Shader::findUniform(std::uint32_t hash, const char* name) const
+{
+    size_t mask = _uniforms.size() - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask)
+    {
+        const UniformSlot &slot = _uniforms[i];
+        if (slot.name.empty())
+            return -1;
+        if (slot.hash == hash && slot.name.compare(name) == 0)
+            return slot.location;
+    }
+}
+
+GLint Shader::bindBlock(const char* name, GLuint binding) const
+{
+    GLuint index = glGetUniformBlockIndex(_handle, name);
+    if (index == GL_INVALID_INDEX)
+        return -1;
+
+    glUniformBlockBinding(_handle, index, binding);
+
+    GLint size = 0;
+    glGetActiveUniformBlockiv(_handle, index, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+    return size;
 }
 
 
 void Shader::setUniform(const std::string &name, bool value) const
 {
-    glUniform1i(glGetUniformLocation(_handle, name.data()), (int) value);
+    setUniform(uniform(name.data()), value);
 }
 
 void Shader::setUniform(const std::string &name, int value) const
 {
-    glUniform1i(glGetUniformLocation(_handle, name.data()), value);
+    setUniform(uniform(name.data()), value);
 }
 
 void Shader::setUniform(const std::string &name, float value) const
 {
-    glUniform1f(glGetUniformLocation(_handle, name.data()), value);
+    setUniform(uniform(name.data()), value);
 }
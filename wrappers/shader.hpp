@@ -1,21 +1,155 @@
 #ifndef SHADER_H_
 #define SHADER_H_
 
+#include "gl_state.hpp"
+#include "shader_preprocessor.hpp"
+
 #include <glad/glad.h>
 
+#include <cstdint>
 #include <string>
+#include <vector>
+
+// A resolved uniform location. Fetch it once with Shader::uniform()
+// and reuse it in the render loop, skipping the name lookup entirely.
+struct UniformHandle
+{
+    GLint location = -1;
+};
+
+// FNV-1a, used to key the uniform table
+constexpr std::uint32_t uniformHash(const char* name, size_t length)
+{
+    std::uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++)
+        hash = (hash ^ (unsigned char) name[i]) * 16777619u;
+    return hash;
+}
+
+inline std::uint32_t uniformHash(const char* name)
+{
+    return uniformHash(name, std::char_traits<char>::length(name));
+}
+
+// A uniform name with its hash computed at compile time, so looking it up
+// costs no hashing and no std::string. Spell it as "mix_amount"_u.
+struct UniformId
+{
+    std::uint32_t hash;
+    const char* name;
+};
+
+// One per distinct literal. A static constexpr member has to be a
+// constant, so the hash is computed by the compiler even in unoptimized
+// builds, where a plain constexpr function would run on every call.
+template <typename C, C... chars>
+struct UniformLiteral
+{
+    static constexpr char name[] = { chars..., '\0' };
+    static constexpr std::uint32_t hash = uniformHash(name, sizeof...(chars));
+};
+
+// The string literal operator template is a GNU extension (GCC and Clang)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+template <typename C, C... chars>
+constexpr UniformId operator""_u()
+{
+    return { UniformLiteral<C, chars...>::hash, UniformLiteral<C, chars...>::name };
+}
+#pragma GCC diagnostic pop
+
+static_assert(UniformLiteral<char, 'm', 'i', 'x', '_', 'a', 'm', 'o', 'u', 'n', 't'>::hash == 0x471e1396u,
+              "uniform names hash with FNV-1a at compile time");
+static_assert("mix_amount"_u.hash == 0x471e1396u, "\"name\"_u hashes like uniformHash()");
 
 // Wrapper class
 class Shader
 {
+    // Flat open-addressing table of the program's active uniforms,
+    // filled once after linking. Size is always a power of two.
+    struct UniformSlot
+    {
+        std::uint32_t hash = 0;
+        GLint location = -1;
+        std::string name;
+    };
+
     GLuint _handle;
+    std::vector<UniformSlot> _uniforms;
+
+    // Empty for programs that didn't come from files
+    std::string _vertexPath;
+    std::string _fragPath;
+    ShaderDefines _defines;
+    std::vector<std::string> _sourceFiles; // both stages plus their includes
+
+    // A program whose compile and link were issued but not yet checked
+    struct PendingProgram
+    {
+        GLuint vertex = 0;
+        GLuint frag = 0;
+        GLuint program = 0;
+    };
+
+    // Takes ownership of an already linked program
+    explicit Shader(GLuint program);
+
+    // Maps and preprocesses both stages (includes, defines), and lists
+    // every file that went in when files is given
+    static bool loadSources(const char* vShaderPath, const char* fShaderPath, const ShaderDefines &defines,
+                            ShaderSource &vertexCode, ShaderSource &fragCode,
+                            std::vector<std::string>* files = nullptr);
+
+    // Compiles and links a program from sources, 0 if linking failed
+    static GLuint compileProgram(const ShaderSource &vCode, const ShaderSource &fCode);
+    static PendingProgram submitProgram(const ShaderSource &vCode, const ShaderSource &fCode);
+    static GLuint finishProgram(const PendingProgram &pending);
+
+    // Swaps in a new linked program, deleting the old one. Uniform values
+    // and handles from the old program don't carry over.
+    void replaceProgram(GLuint program);
+
+    void cacheUniforms();
+    void insertUniform(const std::string &name, GLint location);
+    GLint findUniform(const char* name) const { return findUniform(uniformHash(name), name); }
+    GLint findUniform(std::uint32_t hash, const char* name) const;
+
+    friend class ShaderBatch;
+    friend class ShaderReloader;
 
     public:
-        // Takes in vertex and fragment shader file paths
-        Shader(const char* vShaderPath, const char* fShaderPath);
+        // Takes in vertex and fragment shader file paths, and optionally
+        // defines to specialize both stages with (see ShaderPreprocessor)
+        Shader(const char* vShaderPath, const char* fShaderPath, const ShaderDefines &defines = ShaderDefines());
+
+        // glUseProgram, skipped when it is already current (GLState)
+        void use() { GLState::useProgram(_handle); }
+
+        // The program name, for code that talks to GL directly
+        GLuint handle() const { return _handle; }
+
+        const std::string& vertexPath() const { return _vertexPath; }
+        const std::string& fragPath() const { return _fragPath; }
+        const ShaderDefines& defines() const { return _defines; }
+        const std::vector<std::string>& sourceFiles() const { return _sourceFiles; }
+
+        // Looks up a uniform in the cache. Unknown names give an invalid
+        // handle, which glUniform* silently ignores (same as location -1).
+        UniformHandle uniform(const char* name) const { return { findUniform(name) }; }
+        UniformHandle uniform(UniformId id) const { return { findUniform(id.hash, id.name) }; }
+
+        void setUniform(UniformHandle u, bool value) const { glUniform1i(u.location, (int) value); }
+        void setUniform(UniformHandle u, int value) const { glUniform1i(u.location, value); }
+        void setUniform(UniformHandle u, float value) const { glUniform1f(u.location, value); }
+
+        void setUniform(UniformId id, bool value) const { setUniform(uniform(id), value); }
+        void setUniform(UniformId id, int value) const { setUniform(uniform(id), value); }
+        void setUniform(UniformId id, float value) const { setUniform(uniform(id), value); }
 
-        // glUseProgram
-        void use() { glUseProgram(_handle); }
+        // Points a uniform block at a binding point (glUniformBlockBinding).
+        // Returns the block's size in bytes, or -1 if there is no such block.
+        GLint bindBlock(const char* name, GLuint binding) const;
 
         void setUniform(const std::string &name, bool value) const;
         void setUniform(const std::string &name, int value) const;
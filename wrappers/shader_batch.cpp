@@ -0,0 +1,134 @@
+#include "shader_batch.hpp"
+#include "program_cache.hpp"
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+// glad was generated without extensions, so the token is spelled out here
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+ShaderBatch::ShaderBatch()
+    : _parallel(parallelCompileSupported())
+{
+}
+
+bool ShaderBatch::parallelCompileSupported()
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        const char* name = (const char*) glGetStringi(GL_EXTENSIONS, i);
+        if (std::strcmp(name, "GL_KHR_parallel_shader_compile") == 0
+            || std::strcmp(name, "GL_ARB_parallel_shader_compile") == 0)
+            return true;
+    }
+    return false;
+}
+
+size_t ShaderBatch::add(const char* vShaderPath, const char* fShaderPath, const ShaderDefines &defines)
+{
+    Entry entry;
+    entry.vPath = vShaderPath;
+    entry.fPath = fShaderPath;
+    entry.defines = defines;
+    _entries.push_back(entry);
+    return _entries.size() - 1;
+}
+
+std::map<std::string, size_t> ShaderBatch::addDirectory(const char* directory, const ShaderDefines &defines)
+{
+    std::map<std::string, size_t> indices;
+    std::error_code error;
+    std::filesystem::directory_iterator files(directory, error);
+    if (error)
+    {
+        std::cout << "ERROR::SHADER_BATCH::DIRECTORY_NOT_READ\n" << directory << std::endl;
+        return indices;
+    }
+
+    // Sorted, so indices don't depend on the order the filesystem lists
+    std::map<std::string, std::string> vertexPaths;
+    for (const std::filesystem::directory_entry &file : files)
+        if (file.path().extension() == ".vs")
+            vertexPaths[file.path().stem().string()] = file.path().string();
+
+    for (const auto &vertex : vertexPaths)
+    {
+        std::filesystem::path fragPath = std::filesystem::path(vertex.second).replace_extension(".fs");
+        if (std::filesystem::exists(fragPath))
+            indices[vertex.first] = add(vertex.second.data(), fragPath.string().data(), defines);
+    }
+    return indices;
+}
+
+void ShaderBatch::submit()
+{
+    for (Entry &entry : _entries)
+    {
+        if (entry.submitted)
+            continue;
+        entry.submitted = true;
+
+        ShaderSource vertexCode, fragCode;
+        Shader::loadSources(entry.vPath.data(), entry.fPath.data(), entry.defines, vertexCode, fragCode,
+                            &entry.sourceFiles);
+
+        entry.cacheKey = ProgramCache::key(vertexCode, fragCode);
+        entry.program = ProgramCache::load(entry.cacheKey);
+        if (entry.program != 0)
+        {
+            entry.complete = true;
+            continue;
+        }
+
+        entry.pending = Shader::submitProgram(vertexCode, fragCode);
+    }
+}
+
+bool ShaderBatch::ready()
+{
+    // Polling a program that was never created would only raise
+    // GL_INVALID_VALUE and never report done
+    submit();
+    if (!_parallel)
+        return true;
+
+    bool allDone = true;
+    for (Entry &entry : _entries)
+    {
+        if (entry.complete)
+            continue;
+
+        // The link can only finish after both compiles, so this one query
+        // covers the whole program
+        GLint done = GL_FALSE;
+        glGetProgramiv(entry.pending.program, GL_COMPLETION_STATUS_KHR, &done);
+        if (!done)
+            allDone = false;
+    }
+    return allDone;
+}
+
+Shader ShaderBatch::take(size_t index)
+{
+    Entry &entry = _entries[index];
+    if (!entry.submitted)
+        submit();
+    if (!entry.complete)
+    {
+        entry.program = Shader::finishProgram(entry.pending);
+        if (entry.program != 0)
+            ProgramCache::store(entry.cacheKey, entry.program);
+        entry.complete = true;
+    }
+
+    Shader shader(entry.program);
+    shader._vertexPath = entry.vPath;
+    shader._fragPath = entry.fPath;
+    shader._defines = entry.defines;
+    shader._sourceFiles = entry.sourceFiles;
+    return shader;
+}
@@ -0,0 +1,69 @@
+#ifndef SHADER_BATCH_H_
+#define SHADER_BATCH_H_
+
+#include "shader.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Builds many Shaders at once. Every compile and link is submitted up front,
+// so the driver can overlap them instead of finishing each one before the
+// next starts. With GL_KHR_parallel_shader_compile, ready() can be polled
+// once per frame without ever blocking.
+//
+//     ShaderBatch batch;
+//     size_t quad = batch.add("quad.vs", "quad.fs");
+//     batch.submit();
+//     while (!batch.ready()) { /* draw a loading frame */ }
+//     Shader quadShader = batch.take(quad);
+class ShaderBatch
+{
+    struct Entry
+    {
+        std::string vPath;
+        std::string fPath;
+        ShaderDefines defines;
+        std::vector<std::string> sourceFiles;
+        std::string cacheKey;
+        Shader::PendingProgram pending;
+        GLuint program = 0; // set once the program came from cache or finished
+        bool submitted = false;
+        bool complete = false;
+    };
+
+    std::vector<Entry> _entries;
+    bool _parallel;
+
+    public:
+        ShaderBatch();
+
+        // Queues a program and returns its index in the batch
+        size_t add(const char* vShaderPath, const char* fShaderPath, const ShaderDefines &defines = ShaderDefines());
+
+        // Queues every name.vs + name.fs pair in a directory (not its
+        // subdirectories) and returns their indices by name
+        std::map<std::string, size_t> addDirectory(const char* directory,
+                                                   const ShaderDefines &defines = ShaderDefines());
+
+        // Reads every source and issues all compiles and links. Programs
+        // added since the last call are submitted; earlier ones are skipped.
+        void submit();
+
+        // True once every program has finished compiling. Submits anything
+        // not yet submitted first. Only polls when parallel compile is
+        // available, otherwise it reports ready and take() waits on the
+        // driver instead.
+        bool ready();
+
+        // Checks the status of one program and wraps it (waits if needed,
+        // and submits first if it wasn't yet)
+        Shader take(size_t index);
+
+        size_t size() const { return _entries.size(); }
+
+        // True if the context exposes KHR/ARB_parallel_shader_compile
+        static bool parallelCompileSupported();
+};
+
+#endif // SHADER_BATCH_H_
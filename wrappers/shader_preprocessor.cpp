@@ -0,0 +1,288 @@
+#include "shader_preprocessor.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    struct Expansion
+    {
+        explicit Expansion(ShaderSource &source) : output(source) {}
+
+        ShaderSource &output;
+        std::vector<std::string> files;
+        std::vector<std::string> stack; // files being expanded, to catch cycles
+        bool definesInjected = false;
+    };
+
+    // Makes the line after the directive count as line `line` of `file`
+    std::string lineDirective(size_t line, size_t file)
+    {
+        return "#line " + std::to_string(line) + " " + std::to_string(file) + "\n";
+    }
+
+    std::string defineLines(const ShaderDefines &defines)
+    {
+        std::string lines;
+        for (const std::string &define : defines)
+        {
+            size_t equals = define.find('=');
+            if (equals == std::string::npos)
+                lines += "#define " + define + " 1\n";
+            else
+                lines += "#define " + define.substr(0, equals) + " " + define.substr(equals + 1) + "\n";
+        }
+        return lines;
+    }
+
+    bool startsWith(const char* text, size_t length, const char* prefix)
+    {
+        size_t prefixLength = std::char_traits<char>::length(prefix);
+        return length >= prefixLength && std::memcmp(text, prefix, prefixLength) == 0;
+    }
+
+    bool expand(const std::string &path, Expansion &expansion, const ShaderDefines* defines)
+    {
+        ShaderSource &output = expansion.output;
+        int fileIndex = output.addFile(path.data());
+        if (fileIndex < 0)
+        {
+            std::cout << "ERROR::SHADER::PREPROCESSOR::FILE_NOT_READ\n" << path << std::endl;
+            return false;
+        }
+        const char* source = output.fileData(fileIndex);
+        size_t size = output.fileSize(fileIndex);
+
+        expansion.files.push_back(path);
+        expansion.stack.push_back(path);
+        if (fileIndex > 0)
+            output.appendText(lineDirective(1, fileIndex));
+
+        size_t lineNumber = 0;
+        for (size_t pos = 0; pos < size; )
+        {
+            const char* newline = (const char*) std::memchr(source + pos, '\n', size - pos);
+            size_t end = newline ? newline - source : size;
+            size_t lineStart = pos;
+            pos = end + 1;
+            lineNumber++;
+
+            const char* directive = source + lineStart;
+            while (directive < source + end && (*directive == ' ' || *directive == '\t'))
+                directive++;
+            size_t directiveLength = source + end - directive;
+
+            if (defines && startsWith(directive, directiveLength, "#version"))
+            {
+                output.appendFile(fileIndex, lineStart, end - lineStart);
+                output.appendText("\n" + defineLines(*defines) + lineDirective(lineNumber + 1, fileIndex));
+                expansion.definesInjected = true;
+                defines = nullptr;
+                continue;
+            }
+
+            if (startsWith(directive, directiveLength, "#include"))
+            {
+                const char* open = (const char*) std::memchr(directive, '"', directiveLength);
+                const char* close = open ? (const char*) std::memchr(open + 1, '"', source + end - open - 1) : nullptr;
+                if (!close)
+                {
+                    std::cout << "ERROR::SHADER::PREPROCESSOR::BAD_INCLUDE\n" << path << ":" << lineNumber << std::endl;
+                    return false;
+                }
+
+                std::filesystem::path parent = std::filesystem::path(path).parent_path();
+                std::string included = (parent / std::string(open + 1, close)).lexically_normal().string();
+
+                if (std::find(expansion.stack.begin(), expansion.stack.end(), included) != expansion.stack.end())
+                {
+                    std::cout << "ERROR::SHADER::PREPROCESSOR::INCLUDE_CYCLE\n" << path << ":" << lineNumber
+                              << " includes " << included << std::endl;
+                    return false;
+                }
+
+                // Already in this shader: once is enough, keep the line count
+                if (std::find(expansion.files.begin(), expansion.files.end(), included) != expansion.files.end())
+                {
+                    output.appendText("\n");
+                    continue;
+                }
+
+                if (!expand(included, expansion, nullptr))
+                    return false;
+                source = output.fileData(fileIndex); // reading the include may have moved it
+                output.appendText(lineDirective(lineNumber + 1, fileIndex));
+                continue;
+            }
+
+            // Ordinary lines run on into the previous piece of the file
+            if (end < size)
+                output.appendFile(fileIndex, lineStart, end + 1 - lineStart);
+            else
+            {
+                output.appendFile(fileIndex, lineStart, end - lineStart);
+                output.appendText("\n");
+            }
+        }
+
+        expansion.stack.pop_back();
+        return true;
+    }
+}
+
+int ShaderSource::addFile(const char* path)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    struct stat info;
+    File file;
+    bool success = fstat(fd, &info) == 0;
+    if (success)
+    {
+        file.size = (size_t) info.st_size;
+        if (file.size >= mapThreshold)
+        {
+            file.mapping = MappedFile(path, true);
+            success = file.mapping.valid();
+        }
+        else
+        {
+            file.offset = _read.size();
+            _read.resize(file.offset + file.size);
+
+            ssize_t count = 1;
+            size_t done = 0;
+            while (done < file.size && (count = read(fd, _read.data() + file.offset + done, file.size - done)) > 0)
+                done += (size_t) count;
+
+            // Less than fstat said if the file shrank meanwhile
+            success = count >= 0;
+            file.size = done;
+            _read.resize(file.offset + done);
+        }
+    }
+    close(fd);
+
+    if (!success)
+        return -1;
+    _files.push_back(std::move(file));
+    return (int) _files.size() - 1;
+}
+
+const char* ShaderSource::fileData(int file) const
+{
+    const File &entry = _files[file];
+    if (entry.mapping.valid())
+        return (const char*) entry.mapping.data();
+    return _read.data() + entry.offset;
+}
+
+void ShaderSource::appendFile(int file, size_t offset, size_t length)
+{
+    if (length == 0)
+        return;
+
+    if (!_pieces.empty() && _pieces.back().file == file && _pieces.back().offset + _pieces.back().length == offset)
+        _pieces.back().length += length;
+    else
+        _pieces.push_back({ file, offset, length });
+}
+
+void ShaderSource::appendText(const std::string &text)
+{
+    appendFile(-1, _generated.size(), text.size());
+    _generated.insert(_generated.end(), text.begin(), text.end());
+}
+
+void ShaderSource::prependText(const std::string &text)
+{
+    _pieces.insert(_pieces.begin(), { -1, _generated.size(), text.size() });
+    _generated.insert(_generated.end(), text.begin(), text.end());
+}
+
+void ShaderSource::finish()
+{
+    _strings.clear();
+    _lengths.clear();
+    _size = 0;
+    for (const Piece &piece : _pieces)
+    {
+        const char* base = piece.file < 0 ? _generated.data() : fileData(piece.file);
+        _strings.push_back(base + piece.offset);
+        _lengths.push_back((GLint) piece.length);
+        _size += piece.length;
+    }
+}
+
+std::string ShaderSource::str() const
+{
+    std::string joined;
+    joined.reserve(_size);
+    for (GLsizei i = 0; i < count(); i++)
+        joined.append(_strings[i], _lengths[i]);
+    return joined;
+}
+
+void ShaderSource::detach()
+{
+    std::string joined = str();
+    clear();
+    _read.shrink_to_fit();
+    appendText(joined);
+    finish();
+}
+
+void ShaderSource::clear()
+{
+    _files.clear();
+    _read.clear();
+    _generated.clear();
+    _pieces.clear();
+    _strings.clear();
+    _lengths.clear();
+    _size = 0;
+}
+
+bool ShaderPreprocessor::process(const std::string &path, const ShaderDefines &defines, ShaderSource &output,
+                                 std::vector<std::string>* files)
+{
+    output.clear();
+    Expansion expansion(output);
+    bool success = expand(path, expansion, &defines);
+
+    if (files)
+        files->insert(files->end(), expansion.files.begin(), expansion.files.end());
+    if (!success)
+    {
+        output.clear();
+        return false;
+    }
+
+    // No #version (so GLSL 1.10), the defines simply go first
+    if (!expansion.definesInjected && !defines.empty())
+        output.prependText(defineLines(defines) + lineDirective(1, 0));
+
+    output.finish();
+    return true;
+}
+
+std::string ShaderPreprocessor::permutationKey(const ShaderDefines &defines)
+{
+    ShaderDefines sorted = defines;
+    std::sort(sorted.begin(), sorted.end());
+
+    std::string key;
+    for (const std::string &define : sorted)
+    {
+        if (!key.empty())
+            key += ";";
+        key += define;
+    }
+    return key;
+}
@@ -0,0 +1,108 @@
+#ifndef SHADER_PREPROCESSOR_H_
+#define SHADER_PREPROCESSOR_H_
+
+#include "mapped_file.hpp"
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+
+// Preprocessor symbols for one shader permutation, "NAME" or "NAME=VALUE"
+typedef std::vector<std::string> ShaderDefines;
+
+// One preprocessed shader stage, kept as pieces instead of one string.
+// Most pieces point straight at the source files' contents, the rest at
+// the few lines the preprocessor generated (#define, #line), and they go
+// to glShaderSource as they are:
+//
+//     glShaderSource(shader, source.count(), source.strings(), source.lengths());
+//
+// Large files are memory-mapped, so their contents are never copied on our
+// side. Small ones (most shaders) are read whole into a buffer that is
+// reused from one process() to the next, because below a few hundred KB
+// setting up and tearing down a mapping costs more than the copy.
+class ShaderSource
+{
+    struct Piece
+    {
+        int file; // index into _files, -1 for _generated
+        size_t offset;
+        size_t length;
+    };
+
+    struct File
+    {
+        MappedFile mapping; // large files
+        size_t offset = 0;  // small files, where they start in _read
+        size_t size = 0;
+    };
+
+    std::vector<File> _files;
+    std::vector<char> _read;
+    std::vector<char> _generated;
+    std::vector<Piece> _pieces;
+
+    // What glShaderSource gets, filled in by finish()
+    std::vector<const GLchar*> _strings;
+    std::vector<GLint> _lengths;
+    size_t _size = 0;
+
+    public:
+        // Files at least this big are mapped instead of read
+        static const size_t mapThreshold = 256 * 1024;
+
+        // Building one up, as ShaderPreprocessor does. Pieces are only
+        // resolved to pointers by finish(), so adding is cheap. addFile()
+        // returns -1 if the file can't be read. fileData() stays valid
+        // until the next addFile().
+        int addFile(const char* path);
+        const char* fileData(int file) const;
+        size_t fileSize(int file) const { return _files[file].size; }
+        void appendFile(int file, size_t offset, size_t length);
+        void appendText(const std::string &text);
+        void prependText(const std::string &text);
+        void finish();
+
+        GLsizei count() const { return (GLsizei) _strings.size(); }
+        const GLchar* const* strings() const { return _strings.data(); }
+        const GLint* lengths() const { return _lengths.data(); }
+
+        // Total length in bytes
+        size_t size() const { return _size; }
+
+        // The pieces joined into one string, a copy for code that wants one
+        std::string str() const;
+
+        // Copies the contents in and unmaps the files. For sources kept
+        // around while the files may be rewritten, since truncating a file
+        // under its mapping makes reads fault.
+        void detach();
+
+        void clear();
+};
+
+// The bits of preprocessing GLSL doesn't do itself:
+//
+//  - #include "file" pastes in another file, found relative to the one
+//    including it. Each file goes in at most once per shader, so shared
+//    snippets need no include guards. Cycles are an error.
+//  - Defines are injected right after #version, so one source can be
+//    compiled into specialized variants instead of branching on uniforms.
+//
+// #line directives keep compiler errors pointing at the right line. Their
+// source-string numbers index the files list (0 is the top-level file).
+class ShaderPreprocessor
+{
+    public:
+        // Maps path and expands it into output. Returns false (and logs) if
+        // a file can't be read or the includes form a cycle. Every file that
+        // went in is added to files, when given.
+        static bool process(const std::string &path, const ShaderDefines &defines, ShaderSource &output,
+                            std::vector<std::string>* files = nullptr);
+
+        // Same defines in any order give the same key, e.g. "A;B=2"
+        static std::string permutationKey(const ShaderDefines &defines);
+};
+
+#endif // SHADER_PREPROCESSOR_H_
@@ -0,0 +1,548 @@
+#include "shader_reloader.hpp"
+#include "program_cache.hpp"
+#include "shader_batch.hpp"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+#include <set>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+// glad was generated without extensions, so the token is spelled out here
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace
+{
+    // Editors tend to write a file in several steps, so wait until the
+    // directory has been quiet this long before reading anything
+    const int settleMilliseconds = 50;
+
+    std::string absolutePath(const std::string &path)
+    {
+        return std::filesystem::absolute(path).lexically_normal().string();
+    }
+
+    std::string trim(const std::string &text)
+    {
+        size_t first = text.find_first_not_of(" \t\r");
+        if (first == std::string::npos)
+            return "";
+        return text.substr(first, text.find_last_not_of(" \t\r") + 1 - first);
+    }
+
+    std::string leadingIdentifier(const std::string &text)
+    {
+        size_t length = 0;
+        while (length < text.size() && (std::isalnum((unsigned char) text[length]) || text[length] == '_'))
+            length++;
+        return text.substr(0, length);
+    }
+
+    // The #if conditions the bracket check can follow: a number, or
+    // [!]defined NAME / [!]defined(NAME). 1 or 0, -1 for anything else.
+    int evaluateCondition(std::string condition, const std::set<std::string> &defined)
+    {
+        condition = trim(condition);
+        bool negate = !condition.empty() && condition[0] == '!';
+        if (negate)
+            condition = trim(condition.substr(1));
+
+        int value = -1;
+        if (condition.compare(0, 7, "defined") == 0)
+        {
+            std::string rest = trim(condition.substr(7));
+            bool parenthesized = !rest.empty() && rest[0] == '(';
+            if (parenthesized)
+                rest = trim(rest.substr(1));
+            std::string name = leadingIdentifier(rest);
+            rest = trim(rest.substr(name.size()));
+            if (parenthesized && !rest.empty() && rest[0] == ')')
+                rest = trim(rest.substr(1));
+            else if (parenthesized)
+                return -1;
+            if (name.empty() || !rest.empty())
+                return -1;
+            value = defined.count(name) ? 1 : 0;
+        }
+        else if (!condition.empty() && condition.find_first_not_of("0123456789") == std::string::npos)
+            value = std::stoi(condition) != 0 ? 1 : 0;
+        else
+            return -1;
+
+        return negate ? !value : value;
+    }
+
+    // One #if/#ifdef group the bracket check is inside of
+    struct Conditional
+    {
+        bool active; // the current branch is compiled (or might be)
+        bool taken;  // some branch of the group was, so #else/#elif are out
+    };
+
+    // Cheap checks that catch a half-written or obviously broken file before
+    // the driver sees it: there is a #version first, and brackets balance.
+    //
+    // Brackets are only counted in branches that get compiled, going by
+    // the #defines in the source (which include the shader's defines).
+    // Conditions it can't evaluate leave every branch in, so an imbalance
+    // after one of those is only a warning and the driver's compile decides.
+    bool checkSource(const std::string &code, std::string &problem, std::string &warning)
+    {
+        size_t start = code.find_first_not_of(" \t\r\n");
+        while (start != std::string::npos && code[start] == '/')
+        {
+            size_t end = std::string::npos;
+            if (code.compare(start, 2, "//") == 0)
+                end = code.find('\n', start);
+            else if (code.compare(start, 2, "/*") == 0 && code.find("*/", start + 2) != std::string::npos)
+                end = code.find("*/", start + 2) + 2;
+            else
+                break;
+            start = code.find_first_not_of(" \t\r\n", end);
+        }
+        if (start == std::string::npos)
+        {
+            problem = "file is empty";
+            return false;
+        }
+        if (code.compare(start, 8, "#version") != 0)
+        {
+            problem = "#version is not the first directive";
+            return false;
+        }
+
+        std::set<std::string> defined;
+        std::vector<Conditional> conditionals;
+        bool uncertain = false;
+        bool lineStart = true;
+        auto live = [&conditionals] {
+            return std::all_of(conditionals.begin(), conditionals.end(),
+                               [] (const Conditional &c) { return c.active; });
+        };
+
+        std::string open;
+        std::string imbalance;
+        for (size_t i = start; i < code.size() && imbalance.empty(); i++)
+        {
+            char c = code[i];
+            if (c == '\n')
+            {
+                lineStart = true;
+                continue;
+            }
+            if (lineStart && (c == ' ' || c == '\t' || c == '\r'))
+                continue;
+
+            if (lineStart && c == '#')
+            {
+                size_t end = std::min(code.find('\n', i), code.size());
+                std::string line = trim(code.substr(i + 1, end - i - 1));
+                std::string directive = leadingIdentifier(line);
+                std::string argument = trim(line.substr(directive.size()));
+                i = end - 1;
+
+                if (directive == "if" || directive == "ifdef" || directive == "ifndef")
+                {
+                    int value = !live() ? 0
+                              : directive == "if" ? evaluateCondition(argument, defined)
+                              : (defined.count(leadingIdentifier(argument)) != 0) == (directive == "ifdef");
+                    uncertain |= value < 0;
+                    conditionals.push_back({ value != 0, value > 0 || !live() });
+                }
+                else if ((directive == "elif" || directive == "else") && !conditionals.empty())
+                {
+                    // Groups inside a branch that's out start out taken
+                    Conditional &group = conditionals.back();
+                    int value = group.taken ? 0 : directive == "else" ? 1 : evaluateCondition(argument, defined);
+                    uncertain |= value < 0;
+                    group.active = value != 0;
+                    group.taken = group.taken || value > 0;
+                }
+                else if (directive == "endif" && !conditionals.empty())
+                    conditionals.pop_back();
+                else if (directive == "define" && live())
+                    defined.insert(leadingIdentifier(argument));
+                else if (directive == "undef" && live())
+                    defined.erase(leadingIdentifier(argument));
+                continue;
+            }
+            lineStart = false;
+
+            if (c == '/' && i + 1 < code.size() && code[i + 1] == '/')
+                i = std::min(code.find('\n', i), code.size()) - 1;
+            else if (c == '/' && i + 1 < code.size() && code[i + 1] == '*')
+                i = std::min(code.find("*/", i + 2), code.size()) + 1;
+            else if (!live())
+                continue;
+            else if (c == '{' || c == '(' || c == '[')
+                open.push_back(c);
+            else if (c == '}' || c == ')' || c == ']')
+            {
+                char expected = c == '}' ? '{' : c == ')' ? '(' : '[';
+                if (open.empty() || open.back() != expected)
+                    imbalance = std::string("unbalanced '") + c + "'";
+                else
+                    open.pop_back();
+            }
+        }
+        if (imbalance.empty() && !open.empty())
+            imbalance = std::string("unclosed '") + open.back() + "'";
+
+        if (imbalance.empty())
+            return true;
+        if (uncertain)
+        {
+            warning = imbalance + ", but it depends on #if conditions left to the compiler";
+            return true;
+        }
+        problem = imbalance;
+        return false;
+    }
+}
+
+ShaderReloader::ShaderReloader(const AppContext &app)
+    : _ready(64), _parallel(ShaderBatch::parallelCompileSupported())
+{
+    _inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (_inotify < 0 || pipe(_wakePipe) != 0)
+    {
+        std::cout << "ERROR::SHADER_RELOADER::INOTIFY_FAILED\nShaders won't reload" << std::endl;
+        if (_inotify >= 0)
+            close(_inotify);
+        _inotify = -1;
+        return;
+    }
+
+    _compileContext = app.createSharedContext();
+    if (!_compileContext && !_parallel)
+        std::cout << "WARNING::SHADER_RELOADER::COMPILING_ON_RENDER_THREAD\n"
+                  << "No shared context or GL_KHR_parallel_shader_compile, reloads will stall a frame" << std::endl;
+
+    _thread = std::thread(&ShaderReloader::watcherLoop, this);
+}
+
+ShaderReloader::~ShaderReloader()
+{
+    if (_thread.joinable())
+    {
+        char stop = 0;
+        if (write(_wakePipe[1], &stop, 1) == 1)
+            _thread.join();
+        else
+            _thread.detach();
+    }
+
+    for (int fd : { _inotify, _wakePipe[0], _wakePipe[1] })
+        if (fd >= 0)
+            close(fd);
+
+    Sources* sources;
+    while (_ready.pop(sources))
+    {
+        if (sources->program != 0)
+            glDeleteProgram(sources->program);
+        delete sources;
+    }
+
+    for (Watched &watched : _watched)
+        discardPending(watched);
+
+    // The watcher released it before leaving, and it must go before app's
+    _compileContext.reset();
+}
+
+void ShaderReloader::watch(Shader &shader, ReloadCallback onReload)
+{
+    if (!active() || shader.vertexPath().empty())
+        return;
+
+    size_t index = _watched.size();
+    Watched watched;
+    watched.shader = &shader;
+    watched.onReload = onReload;
+    _watched.push_back(watched);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _shaderFiles[index] = { shader.vertexPath(), shader.fragPath(), shader.defines() };
+    for (const std::string &path : shader.sourceFiles())
+        watchFile(path, index);
+    watchFile(shader.vertexPath(), index);
+    watchFile(shader.fragPath(), index);
+}
+
+void ShaderReloader::watchFile(const std::string &path, size_t index)
+{
+    std::string file = absolutePath(path);
+    std::vector<size_t> &indices = _files[file];
+    if (std::find(indices.begin(), indices.end(), index) != indices.end())
+        return;
+
+    std::string directory = std::filesystem::path(file).parent_path().string();
+    int wd = inotify_add_watch(_inotify, directory.data(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (wd < 0)
+    {
+        std::cout << "ERROR::SHADER_RELOADER::WATCH_FAILED\n" << directory << std::endl;
+        return;
+    }
+    _directories[wd] = directory;
+    indices.push_back(index);
+}
+
+void ShaderReloader::unwatch(Shader &shader)
+{
+    for (size_t index = 0; index < _watched.size(); index++)
+    {
+        Watched &watched = _watched[index];
+        if (watched.shader != &shader)
+            continue;
+
+        discardPending(watched);
+        watched.shader = nullptr;
+        watched.onReload = nullptr;
+
+        // The slot stays, so indices already queued by the watcher still
+        // point at the right (now empty) entry
+        std::lock_guard<std::mutex> lock(_mutex);
+        _shaderFiles.erase(index);
+        for (auto &file : _files)
+        {
+            std::vector<size_t> &indices = file.second;
+            for (size_t i = 0; i < indices.size(); i++)
+                if (indices[i] == index)
+                    indices.erase(indices.begin() + i--);
+        }
+    }
+}
+
+void ShaderReloader::update()
+{
+    Sources* sources;
+    while (_ready.pop(sources))
+    {
+        Watched &watched = _watched[sources->index];
+        if (!sources->problem.empty())
+        {
+            std::cout << "ERROR::SHADER_RELOADER::INVALID_SOURCE\n" << sources->problem << std::endl;
+            _stats.rejected++;
+        }
+        else if (watched.shader)
+        {
+            if (!sources->warning.empty())
+                std::cout << "WARNING::SHADER_RELOADER::SUSPICIOUS_SOURCE\n" << sources->warning << std::endl;
+
+            // A newer save wins over a compile still in flight
+            discardPending(watched);
+
+            if (sources->compiled)
+            {
+                swapIn(watched, sources->program);
+                sources->program = 0;
+            }
+            else
+            {
+                watched.cacheKey = ProgramCache::key(sources->vertexCode, sources->fragCode);
+                GLuint program = ProgramCache::load(watched.cacheKey);
+                if (program != 0)
+                {
+                    // Seen this exact source before, e.g. an undo
+                    swapIn(watched, program);
+                }
+                else
+                {
+                    watched.pending = Shader::submitProgram(sources->vertexCode, sources->fragCode);
+                    watched.compiling = true;
+                    watched.justSubmitted = true;
+                }
+            }
+        }
+
+        // Unwatched while it was compiling
+        if (sources->program != 0)
+            glDeleteProgram(sources->program);
+        delete sources;
+    }
+
+    for (Watched &watched : _watched)
+    {
+        if (!watched.compiling)
+            continue;
+
+        // Without parallel compile there is nothing to poll, and finishing
+        // is where the driver does the work, so at least keep it out of the
+        // frame that submitted
+        if (_parallel)
+        {
+            GLint done = GL_FALSE;
+            glGetProgramiv(watched.pending.program, GL_COMPLETION_STATUS_KHR, &done);
+            if (!done)
+                continue;
+        }
+        else if (watched.justSubmitted)
+        {
+            watched.justSubmitted = false;
+            continue;
+        }
+
+        watched.compiling = false;
+        GLuint program = Shader::finishProgram(watched.pending);
+        watched.pending = Shader::PendingProgram();
+        if (program != 0)
+            ProgramCache::store(watched.cacheKey, program);
+        swapIn(watched, program);
+    }
+}
+
+void ShaderReloader::swapIn(Watched &watched, GLuint program)
+{
+    if (program == 0)
+    {
+        std::cout << "ERROR::SHADER_RELOADER::RELOAD_FAILED\nKeeping the previous program for "
+                  << watched.shader->vertexPath() << " + " << watched.shader->fragPath() << std::endl;
+        _stats.failures++;
+        return;
+    }
+
+    watched.shader->replaceProgram(program);
+    _stats.reloads++;
+    if (watched.onReload)
+        watched.onReload(*watched.shader);
+}
+
+void ShaderReloader::discardPending(Watched &watched)
+{
+    if (!watched.compiling)
+        return;
+
+    glDeleteShader(watched.pending.vertex);
+    glDeleteShader(watched.pending.frag);
+    glDeleteProgram(watched.pending.program);
+    watched.pending = Shader::PendingProgram();
+    watched.compiling = false;
+    watched.justSubmitted = false;
+}
+
+void ShaderReloader::watcherLoop()
+{
+    alignas(inotify_event) char buffer[4096];
+    std::set<size_t> changed;
+
+    bool compile = _compileContext && _compileContext->makeCurrent();
+    if (_compileContext && !compile)
+        std::cout << "ERROR::SHADER_RELOADER::SHARED_CONTEXT_FAILED\nReloads will compile on the render thread"
+                  << std::endl;
+
+    for (;;)
+    {
+        pollfd fds[2] = { { _inotify, POLLIN, 0 }, { _wakePipe[0], POLLIN, 0 } };
+        int timeout = changed.empty() ? -1 : settleMilliseconds;
+        int ready = poll(fds, 2, timeout);
+        if (ready < 0 || (fds[1].revents & POLLIN))
+            break;
+
+        if (ready == 0)
+        {
+            // Quiet for a while, so the files should be complete now
+            for (size_t index : changed)
+                reload(index, compile);
+            changed.clear();
+            continue;
+        }
+
+        ssize_t length;
+        while ((length = read(_inotify, buffer, sizeof(buffer))) > 0)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (char* p = buffer; p < buffer + length; p += sizeof(inotify_event) + ((inotify_event*) p)->len)
+            {
+                inotify_event* event = (inotify_event*) p;
+                auto directory = _directories.find(event->wd);
+                if (event->len == 0 || directory == _directories.end())
+                    continue;
+
+                auto file = _files.find(directory->second + "/" + event->name);
+                if (file != _files.end())
+                    changed.insert(file->second.begin(), file->second.end());
+            }
+        }
+    }
+
+    if (compile)
+        _compileContext->makeCurrent(false);
+}
+
+void ShaderReloader::reload(size_t index, bool compile)
+{
+    ShaderFiles files;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto found = _shaderFiles.find(index);
+        if (found == _shaderFiles.end())
+            return;
+        files = found->second;
+    }
+
+    Sources* sources = new Sources();
+    sources->index = index;
+    std::vector<std::string> included;
+    if (!Shader::loadSources(files.vertexPath.data(), files.fragPath.data(), files.defines,
+                             sources->vertexCode, sources->fragCode, &included))
+    {
+        delete sources;
+        return;
+    }
+
+    // Editors may save again before update() gets to these
+    sources->vertexCode.detach();
+    sources->fragCode.detach();
+
+    // The edit may have added includes
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_shaderFiles.count(index))
+            for (const std::string &path : included)
+                watchFile(path, index);
+    }
+
+    std::string problem, warning;
+    if (!checkSource(sources->vertexCode.str(), problem, warning))
+        sources->problem = files.vertexPath + ": " + problem;
+    else if (!warning.empty())
+        sources->warning = files.vertexPath + ": " + warning;
+
+    warning.clear();
+    if (sources->problem.empty() && !checkSource(sources->fragCode.str(), problem, warning))
+        sources->problem = files.fragPath + ": " + problem;
+    else if (sources->problem.empty() && !warning.empty())
+        sources->warning += (sources->warning.empty() ? "" : "\n") + files.fragPath + ": " + warning;
+
+    if (compile && sources->problem.empty())
+        compileSources(*sources);
+
+    if (!_ready.push(sources))
+    {
+        if (sources->program != 0)
+            glDeleteProgram(sources->program);
+        delete sources;
+    }
+}
+
+// Watcher thread, with the shared context current
+void ShaderReloader::compileSources(Sources &sources)
+{
+    std::string key = ProgramCache::key(sources.vertexCode, sources.fragCode);
+    sources.program = ProgramCache::load(key);
+    if (sources.program == 0)
+    {
+        sources.program = Shader::compileProgram(sources.vertexCode, sources.fragCode);
+        if (sources.program != 0)
+            ProgramCache::store(key, sources.program);
+    }
+    sources.compiled = true;
+
+    // Done before the render thread's context uses it
+    glFinish();
+}
@@ -0,0 +1,134 @@
+#ifndef SHADER_RELOADER_H_
+#define SHADER_RELOADER_H_
+
+#include "app_context.hpp"
+#include "mpmc_queue.hpp"
+#include "shader.hpp"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Recompiles Shaders while the sample runs, whenever their .glsl files
+// change on disk.
+//
+//     ShaderReloader reloader { app };
+//     reloader.watch(shader, [&](Shader &s) { handle = s.uniform("mix"_u); });
+//     while (running)
+//     {
+//         reloader.update();
+//         ...
+//     }
+//
+// Files pulled in with #include count too, and the shader's defines are
+// kept, so a variant reloads as the same variant.
+//
+// An inotify thread watches the directories holding the files, so editors
+// that save by renaming a temp file are caught too. It reads the new
+// sources, sanity-checks them, and compiles and links them on a context
+// shared with the app's, so the render loop never waits on the driver.
+// update() then only swaps the finished program in by the shader it
+// belongs to. Where no shared context can be made, update() submits the
+// compile and finishes it a frame later (with GL_KHR_parallel_shader_compile,
+// once the driver says it's done), and a warning at startup says reloads
+// will stall. A program that fails to compile is logged and dropped, and
+// the old one stays.
+class ShaderReloader
+{
+    public:
+        // Runs on the GL thread after a swap. The new program starts with
+        // default uniform values and new locations, so re-resolve handles,
+        // set one-off uniforms and re-attach uniform blocks here.
+        typedef std::function<void(Shader &shader)> ReloadCallback;
+
+        struct Stats
+        {
+            unsigned reloads = 0;
+            unsigned failures = 0; // compile or link errors, old program kept
+            unsigned rejected = 0; // failed the pre-check, never compiled
+        };
+
+    private:
+    // GL thread only
+    struct Watched
+    {
+        Shader* shader;
+        ReloadCallback onReload;
+        Shader::PendingProgram pending;
+        std::string cacheKey;
+        bool compiling = false;
+        bool justSubmitted = false;
+    };
+
+    // What the watcher thread needs to rebuild a shader's sources
+    struct ShaderFiles
+    {
+        std::string vertexPath;
+        std::string fragPath;
+        ShaderDefines defines;
+    };
+
+    // Read and checked by the watcher thread, handed to update()
+    struct Sources
+    {
+        size_t index;
+        ShaderSource vertexCode;
+        ShaderSource fragCode;
+        std::string problem; // set if the pre-check failed
+        std::string warning; // set if it passed with doubts
+        bool compiled = false; // by the watcher thread, program is the result
+        GLuint program = 0;    // 0 if it failed to compile
+    };
+
+    std::vector<Watched> _watched;
+    MPMCQueue<Sources*> _ready;
+    bool _parallel;
+    Stats _stats;
+    std::unique_ptr<SharedContext> _compileContext; // current on the watcher thread
+
+    // Shared with the watcher thread
+    std::mutex _mutex;
+    std::map<int, std::string> _directories;                // inotify watch -> directory
+    std::map<std::string, std::vector<size_t>> _files;      // absolute path -> watched indices
+    std::map<size_t, ShaderFiles> _shaderFiles;             // watched index -> how to rebuild it
+
+    int _inotify = -1;
+    int _wakePipe[2] = { -1, -1 };
+    std::thread _thread;
+
+    // Caller holds _mutex
+    void watchFile(const std::string &path, size_t index);
+
+    void watcherLoop();
+    void reload(size_t index, bool compile);
+    void compileSources(Sources &sources);
+    void swapIn(Watched &watched, GLuint program);
+    void discardPending(Watched &watched);
+
+    public:
+        // Needs app's context current, like Shader
+        explicit ShaderReloader(const AppContext &app);
+        ~ShaderReloader();
+
+        ShaderReloader(const ShaderReloader&) = delete;
+        ShaderReloader& operator=(const ShaderReloader&) = delete;
+
+        // Starts watching the files shader was built from. The shader must
+        // stay where it is until unwatch() or the reloader goes away.
+        void watch(Shader &shader, ReloadCallback onReload = nullptr);
+        void unwatch(Shader &shader);
+
+        // Swaps in whatever finished compiling. Call once per frame on the
+        // GL thread, outside of any draws using the watched shaders.
+        void update();
+
+        // False if inotify couldn't be set up, watching then does nothing
+        bool active() const { return _inotify >= 0; }
+        const Stats& stats() const { return _stats; }
+};
+
+#endif // SHADER_RELOADER_H_
@@ -0,0 +1,20 @@
+#include "shader_variants.hpp"
+
+ShaderVariants::ShaderVariants(const char* vShaderPath, const char* fShaderPath)
+    : _vertexPath(vShaderPath), _fragPath(fShaderPath)
+{
+}
+
+Shader& ShaderVariants::get(const ShaderDefines &defines)
+{
+    std::unique_ptr<Shader> &variant = _variants[ShaderPreprocessor::permutationKey(defines)];
+    if (!variant)
+        variant.reset(new Shader(_vertexPath.data(), _fragPath.data(), defines));
+    return *variant;
+}
+
+Shader* ShaderVariants::find(const ShaderDefines &defines) const
+{
+    auto found = _variants.find(ShaderPreprocessor::permutationKey(defines));
+    return found != _variants.end() ? found->second.get() : nullptr;
+}
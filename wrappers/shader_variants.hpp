@@ -0,0 +1,39 @@
+#ifndef SHADER_VARIANTS_H_
+#define SHADER_VARIANTS_H_
+
+#include "shader.hpp"
+
+#include <map>
+#include <memory>
+#include <string>
+
+// Every permutation of one vertex/fragment pair, each compiled into its own
+// specialized program the first time it is asked for and kept after that.
+// Variants are keyed by ShaderPreprocessor::permutationKey, so the order
+// of the defines doesn't matter.
+//
+//     ShaderVariants variants { "quad.vs", "quad.fs" };
+//     Shader &plain = variants.get({});
+//     Shader &fancy = variants.get({ "FOG", "LIGHTS=4" });
+//
+// Shaders stay at the same address for the lifetime of the variants, so
+// they can be handed to a ShaderReloader.
+class ShaderVariants
+{
+    std::string _vertexPath;
+    std::string _fragPath;
+    std::map<std::string, std::unique_ptr<Shader>> _variants;
+
+    public:
+        ShaderVariants(const char* vShaderPath, const char* fShaderPath);
+
+        // Compiles the variant on first use (or loads it from ProgramCache)
+        Shader& get(const ShaderDefines &defines);
+
+        // Looks a variant up without compiling it, null if there is none yet
+        Shader* find(const ShaderDefines &defines) const;
+
+        size_t size() const { return _variants.size(); }
+};
+
+#endif // SHADER_VARIANTS_H_
@@ -0,0 +1,96 @@
+#include "static_draw_list.hpp"
+#include "gl_state.hpp"
+#include <iostream>
+
+StaticDrawList::StaticDrawList(bool useIndirect)
+    : _indirect(useIndirect && indirectSupported())
+{
+    glGenVertexArrays(1, &_vao);
+    glGenBuffers(1, &_vbo);
+    glGenBuffers(1, &_ebo);
+    if (_indirect)
+        glGenBuffers(1, &_indirectBuffer);
+}
+
+StaticDrawList::~StaticDrawList()
+{
+    GLState::deleteVertexArrays(1, &_vao);
+    GLState::deleteBuffers(1, &_vbo);
+    GLState::deleteBuffers(1, &_ebo);
+    if (_indirectBuffer)
+        GLState::deleteBuffers(1, &_indirectBuffer);
+}
+
+bool StaticDrawList::indirectSupported()
+{
+    return GLAD_GL_VERSION_4_3 && glMultiDrawElementsIndirect;
+}
+
+size_t StaticDrawList::add(const BatchVertex* vertices, size_t vertexCount, const GLuint* indices, size_t indexCount)
+{
+    if (_built)
+    {
+        std::cout << "ERROR::STATIC_DRAW_LIST::ADD_AFTER_BUILD" << std::endl;
+        return (size_t) -1;
+    }
+
+    _commands.push_back({ (GLuint) indexCount, 1, (GLuint) _indices.size(), (GLint) _vertices.size(), 0 });
+    _vertices.insert(_vertices.end(), vertices, vertices + vertexCount);
+    _indices.insert(_indices.end(), indices, indices + indexCount);
+    return _commands.size() - 1;
+}
+
+void StaticDrawList::build()
+{
+    GLState::bindVertexArray(_vao);
+
+    GLState::bindBuffer(GL_ARRAY_BUFFER, _vbo);
+    glBufferData(GL_ARRAY_BUFFER, _vertices.size() * sizeof(BatchVertex), _vertices.data(), GL_STATIC_DRAW);
+    GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, _indices.size() * sizeof(GLuint), _indices.data(), GL_STATIC_DRAW);
+
+    BatchVertexLayout::apply();
+
+    GLState::bindVertexArray(0);
+
+    if (_indirect)
+    {
+        GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, _indirectBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, _commands.size() * sizeof(DrawElementsIndirectCommand),
+                     _commands.data(), GL_STATIC_DRAW);
+        GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+    else
+    {
+        for (const DrawElementsIndirectCommand &command : _commands)
+        {
+            _counts.push_back(command.count);
+            _offsets.push_back((const void*) (command.firstIndex * sizeof(GLuint)));
+            _baseVertices.push_back(command.baseVertex);
+        }
+    }
+
+    // The GPU has its own copy now
+    std::vector<BatchVertex>().swap(_vertices);
+    std::vector<GLuint>().swap(_indices);
+    _built = true;
+}
+
+void StaticDrawList::draw() const
+{
+    if (!_built || _commands.empty())
+        return;
+
+    GLState::bindVertexArray(_vao);
+    if (_indirect)
+    {
+        GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, _indirectBuffer);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, (GLsizei) _commands.size(), 0);
+        GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+    else
+    {
+        glMultiDrawElementsBaseVertex(GL_TRIANGLES, _counts.data(), GL_UNSIGNED_INT, _offsets.data(),
+                                      (GLsizei) _counts.size(), _baseVertices.data());
+    }
+}
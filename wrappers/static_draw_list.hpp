@@ -0,0 +1,74 @@
+#ifndef STATIC_DRAW_LIST_H_
+#define STATIC_DRAW_LIST_H_
+
+#include "batch_renderer.hpp"
+
+#include <glad/glad.h>
+
+#include <vector>
+
+// Layout glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// Every static mesh of a scene packed into one vertex/index buffer and
+// drawn with a single call per frame.
+//
+// On GL 4.3+ the draw commands live in a GL_DRAW_INDIRECT_BUFFER built
+// once, so drawing is one glMultiDrawElementsIndirect with nothing to
+// upload. On the 3.3 core context the samples ask for (the driver may hand
+// out a newer one), it's glMultiDrawElementsBaseVertex with the same
+// commands kept in client arrays.
+//
+// Meshes are static: bake their transforms into the vertices before add().
+class StaticDrawList
+{
+    GLuint _vao;
+    GLuint _vbo;
+    GLuint _ebo;
+    GLuint _indirectBuffer = 0;
+    bool _indirect;
+    bool _built = false;
+
+    std::vector<BatchVertex> _vertices;
+    std::vector<GLuint> _indices;
+    std::vector<DrawElementsIndirectCommand> _commands;
+
+    // Fallback path, the commands split the way glMultiDraw* wants them
+    std::vector<GLsizei> _counts;
+    std::vector<const void*> _offsets;
+    std::vector<GLint> _baseVertices;
+
+    public:
+        // useIndirect is for benchmarking the fallback, it's ignored when
+        // indirect drawing isn't supported
+        explicit StaticDrawList(bool useIndirect = true);
+        ~StaticDrawList();
+
+        StaticDrawList(const StaticDrawList&) = delete;
+        StaticDrawList& operator=(const StaticDrawList&) = delete;
+
+        // Appends a mesh and returns its index. Indices count from the
+        // mesh's first vertex. Only valid before build().
+        size_t add(const BatchVertex* vertices, size_t vertexCount, const GLuint* indices, size_t indexCount);
+
+        // Uploads the geometry and commands and drops the CPU copies
+        void build();
+
+        // Draws every mesh with the current program and textures
+        void draw() const;
+
+        bool indirect() const { return _indirect; }
+        size_t size() const { return _commands.size(); }
+
+        // True on GL 4.3+ (glMultiDrawElementsIndirect is core there)
+        static bool indirectSupported();
+};
+
+#endif // STATIC_DRAW_LIST_H_
@@ -0,0 +1,206 @@
+#include "texture_array.hpp"
+#include "gl_state.hpp"
+#include "texture_file.hpp"
+#include "thread_pool.hpp"
+#include <stb_image.h>
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <thread>
+
+namespace
+{
+    // Copies a level with 1 to 4 channels out as RGBA
+    MipLevel expandToRGBA(const unsigned char* pixels, int width, int height, int channels)
+    {
+        MipLevel level { width, height, std::vector<unsigned char>((size_t) width * height * 4) };
+        unsigned char* out = level.pixels.data();
+        for (size_t i = 0; i < (size_t) width * height; i++, pixels += channels, out += 4)
+        {
+            out[0] = pixels[0];
+            out[1] = channels >= 3 ? pixels[1] : pixels[0];
+            out[2] = channels >= 3 ? pixels[2] : pixels[0];
+            out[3] = channels == 4 ? pixels[3] : channels == 2 ? pixels[1] : 255;
+        }
+        return level;
+    }
+
+    int channelsForFormat(GLenum format)
+    {
+        switch (format)
+        {
+            case GL_RED: return 1;
+            case GL_RG: return 2;
+            case GL_RGB: return 3;
+            default: return 4;
+        }
+    }
+}
+
+int TextureArray::layer(const std::string &path) const
+{
+    auto it = std::find(layers.begin(), layers.end(), path);
+    return it == layers.end() ? -1 : (int) (it - layers.begin());
+}
+
+TextureArrayBuilder::TextureArrayBuilder(bool flipVertically)
+    : _flipVertically(flipVertically)
+{
+}
+
+TextureArrayBuilder::~TextureArrayBuilder()
+{
+    // The jobs write into _images
+    while (!ready())
+        std::this_thread::yield();
+}
+
+size_t TextureArrayBuilder::add(const char* path)
+{
+    _images.push_back({ path, {}, TextureArraySlot() });
+    return _images.size() - 1;
+}
+
+void TextureArrayBuilder::decode(Image &image, ThreadPool* pool) const
+{
+    if (TextureFile::isTextureFile(image.path.c_str()))
+    {
+        // Already flipped and mipmapped at bake time, just widened to RGBA
+        TextureFile file { image.path.c_str() };
+        if (!file.valid())
+        {
+            std::cout << "ERROR::TEXTURE_ARRAY::LOAD_FAILED " << image.path << std::endl;
+            return;
+        }
+
+        int channels = channelsForFormat(file.header().format);
+        for (std::uint32_t i = 0; i < file.header().levelCount; i++)
+        {
+            const TextureFileLevel &level = file.header().levels[i];
+            image.chain.push_back(expandToRGBA(file.levelData(i), level.width, level.height, channels));
+        }
+        return;
+    }
+
+    stbi_set_flip_vertically_on_load_thread(_flipVertically);
+
+    int width, height, channels;
+    unsigned char* data = stbi_load(image.path.c_str(), &width, &height, &channels, 4);
+    if (!data)
+    {
+        std::cout << "ERROR::TEXTURE_ARRAY::LOAD_FAILED " << image.path << std::endl;
+        return;
+    }
+
+    MipOptions options;
+    options.pool = pool;
+    image.chain = buildMipChain(data, width, height, 4, options);
+    stbi_image_free(data);
+}
+
+void TextureArrayBuilder::start(ThreadPool &pool)
+{
+    _started = true;
+    _decoding = _images.size();
+    for (Image &image : _images)
+    {
+        pool.submit([this, &image, &pool] {
+            decode(image, &pool);
+            _decoding.fetch_sub(1, std::memory_order_release);
+        });
+    }
+}
+
+TextureArray TextureArrayBuilder::placeholder() const
+{
+    TextureArray array;
+    array.width = 1;
+    array.height = 1;
+    for (const Image &image : _images)
+        array.layers.push_back(image.path);
+
+    glGenTextures(1, &array.texture);
+    GLState::bindTexture(GL_TEXTURE_2D_ARRAY, array.texture);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    std::vector<unsigned char> white(std::max<size_t>(_images.size(), 1) * 4, 255);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, 1, 1, (GLsizei) (white.size() / 4), 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, white.data());
+    return array;
+}
+
+std::vector<TextureArray> TextureArrayBuilder::build(ThreadPool* pool)
+{
+    if (_started)
+    {
+        while (!ready())
+            std::this_thread::yield();
+    }
+    else if (pool)
+        pool->parallelFor(_images.size(), [this, pool] (size_t i) { decode(_images[i], pool); });
+    else
+        for (Image &image : _images)
+            decode(image, nullptr);
+
+    // Same size, same array; layers in the order images were added
+    std::map<std::pair<int, int>, std::vector<size_t>> groups;
+    for (size_t i = 0; i < _images.size(); i++)
+        if (!_images[i].chain.empty())
+            groups[{ _images[i].chain[0].width, _images[i].chain[0].height }].push_back(i);
+
+    std::vector<TextureArray> arrays;
+    for (const auto &group : groups)
+    {
+        const std::vector<size_t> &members = group.second;
+
+        // Baked and decoded chains could differ in length, keep what all have
+        size_t levels = _images[members[0]].chain.size();
+        for (size_t i : members)
+            levels = std::min(levels, _images[i].chain.size());
+
+        TextureArray array;
+        array.width = group.first.first;
+        array.height = group.first.second;
+
+        glGenTextures(1, &array.texture);
+        GLState::bindTexture(GL_TEXTURE_2D_ARRAY, array.texture);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, (GLint) levels - 1);
+
+        // Storage for every level first, then each layer's images into it
+        GLsizei layerCount = (GLsizei) members.size();
+        for (size_t level = 0; level < levels; level++)
+        {
+            const MipLevel &size = _images[members[0]].chain[level];
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, (GLint) level, GL_RGBA8, size.width, size.height, layerCount, 0,
+                         GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+
+        for (size_t layer = 0; layer < members.size(); layer++)
+        {
+            Image &image = _images[members[layer]];
+            for (size_t level = 0; level < levels; level++)
+            {
+                const MipLevel &mip = image.chain[level];
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint) level, 0, 0, (GLint) layer, mip.width, mip.height, 1,
+                                GL_RGBA, GL_UNSIGNED_BYTE, mip.pixels.data());
+            }
+
+            image.slot = { (int) arrays.size(), (int) layer };
+            array.layers.push_back(image.path);
+
+            // The GPU has it now
+            std::vector<MipLevel>().swap(image.chain);
+        }
+
+        arrays.push_back(array);
+    }
+
+    return arrays;
+}
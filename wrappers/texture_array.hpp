@@ -0,0 +1,107 @@
+#ifndef TEXTURE_ARRAY_H_
+#define TEXTURE_ARRAY_H_
+
+#include "mipmap.hpp"
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// One GL_TEXTURE_2D_ARRAY: same-sized RGBA8 images as layers, each with a
+// full mip chain. Bound once, a shader picks the image per draw, instance
+// or vertex with the layer index:
+//
+//     uniform sampler2DArray textures;
+//     flat in int layer;
+//     ... texture(textures, vec3(texCoord, layer)) ...
+struct TextureArray
+{
+    GLuint texture = 0;
+    int width = 0;
+    int height = 0;
+    std::vector<std::string> layers; // image path per layer
+
+    // Layer of an image path given to the builder, -1 if not in this array
+    int layer(const std::string &path) const;
+};
+
+// Where an image added to a TextureArrayBuilder ended up
+struct TextureArraySlot
+{
+    int array = -1; // index into what build() returned, -1 if loading failed
+    int layer = -1;
+};
+
+// Groups images by size into texture arrays.
+//
+//     TextureArrayBuilder builder;
+//     size_t crate = builder.add("container.jpg");
+//     size_t face = builder.add("awesomeface.png");
+//     std::vector<TextureArray> arrays = builder.build(&pool);
+//     TextureArraySlot slot = builder.slot(face); // arrays[slot.array], layer slot.layer
+//
+// Images are decoded with stb_image (or mapped, for baked .txb files) and
+// mipmapped on the CPU, in parallel when given a pool. Everything is
+// expanded to RGBA so images with different channel counts can share an
+// array.
+//
+// To keep the first frames from waiting on decoding, start() it on a pool
+// instead and draw with placeholder() until ready():
+//
+//     builder.start(pool);
+//     TextureArray loading = builder.placeholder(); // image i is layer i
+//     ... each frame: if (builder.ready()) arrays = builder.build();
+class TextureArrayBuilder
+{
+    struct Image
+    {
+        std::string path;
+        std::vector<MipLevel> chain; // RGBA, level 0 first; empty if loading failed
+        TextureArraySlot slot;
+    };
+
+    bool _flipVertically;
+    std::vector<Image> _images;
+    bool _started = false;
+    std::atomic<size_t> _decoding{0}; // images start() has yet to finish
+
+    void decode(Image &image, ThreadPool* pool) const;
+
+    public:
+        explicit TextureArrayBuilder(bool flipVertically = true);
+
+        // Waits for decodes start() left running
+        ~TextureArrayBuilder();
+
+        TextureArrayBuilder(const TextureArrayBuilder&) = delete;
+        TextureArrayBuilder& operator=(const TextureArrayBuilder&) = delete;
+
+        // Queues an image and returns its index. Not after start().
+        size_t add(const char* path);
+
+        // Decodes everything queued on the pool's workers and returns right
+        // away. The pool must outlive the decodes.
+        void start(ThreadPool &pool);
+
+        // True once everything start() queued is decoded, so build() won't block
+        bool ready() const { return _decoding.load(std::memory_order_acquire) == 0; }
+
+        // A 1x1 white array with one layer per image added, REPEAT wrapping,
+        // to draw with while start() runs. The caller's to delete.
+        TextureArray placeholder() const;
+
+        // Creates one array per image size, REPEAT wrapping and trilinear
+        // filtering, decoding everything first unless start() did (then it
+        // waits for that instead). The arrays are the caller's to delete
+        // (GLState::deleteTextures). Leaves the last one bound.
+        std::vector<TextureArray> build(ThreadPool* pool = nullptr);
+
+        // Valid after build()
+        TextureArraySlot slot(size_t index) const { return _images[index].slot; }
+};
+
+#endif // TEXTURE_ARRAY_H_
@@ -0,0 +1,391 @@
+#include "texture_atlas.hpp"
+#include "gl_state.hpp"
+#include "texture_file.hpp"
+#include <stb_image.h>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+SkylinePacker::SkylinePacker(int width, int height)
+    : _width(width), _height(height)
+{
+    clear();
+}
+
+void SkylinePacker::clear()
+{
+    _skyline.assign(1, { 0, 0, _width });
+    _usedArea = 0;
+}
+
+int SkylinePacker::usedHeight() const
+{
+    int height = 0;
+    for (const Node &node : _skyline)
+        height = std::max(height, node.y);
+    return height;
+}
+
+int SkylinePacker::fit(size_t index, int width, int height) const
+{
+    if (_skyline[index].x + width > _width)
+        return -1;
+
+    // The rectangle rests on the highest node it spans
+    int y = 0;
+    int remaining = width;
+    for (size_t i = index; remaining > 0; i++)
+    {
+        y = std::max(y, _skyline[i].y);
+        if (y + height > _height)
+            return -1;
+        remaining -= _skyline[i].width;
+    }
+    return y;
+}
+
+bool SkylinePacker::insert(int width, int height, int &x, int &y)
+{
+    size_t best = _skyline.size();
+    int bestTop = INT_MAX;
+    int bestWidth = INT_MAX;
+    for (size_t i = 0; i < _skyline.size(); i++)
+    {
+        int top = fit(i, width, height);
+        if (top < 0)
+            continue;
+
+        // Lowest top edge first, then the narrowest ledge to waste less
+        if (top + height < bestTop || (top + height == bestTop && _skyline[i].width < bestWidth))
+        {
+            best = i;
+            bestTop = top + height;
+            bestWidth = _skyline[i].width;
+            y = top;
+        }
+    }
+
+    if (best == _skyline.size())
+        return false;
+
+    x = _skyline[best].x;
+    _skyline.insert(_skyline.begin() + best, { x, y + height, width });
+
+    // Nodes now under the new one shrink or go away
+    for (size_t i = best + 1; i < _skyline.size();)
+    {
+        int covered = _skyline[i - 1].x + _skyline[i - 1].width - _skyline[i].x;
+        if (covered <= 0)
+            break;
+
+        _skyline[i].x += covered;
+        _skyline[i].width -= covered;
+        if (_skyline[i].width > 0)
+            break;
+        _skyline.erase(_skyline.begin() + i);
+    }
+
+    // Neighbours at the same height become one ledge
+    for (size_t i = 0; i + 1 < _skyline.size();)
+    {
+        if (_skyline[i].y == _skyline[i + 1].y)
+        {
+            _skyline[i].width += _skyline[i + 1].width;
+            _skyline.erase(_skyline.begin() + i + 1);
+        }
+        else
+            i++;
+    }
+
+    _usedArea += (long long) width * height;
+    return true;
+}
+
+TextureAtlas::TextureAtlas(int pageSize, int padding)
+    : _pageSize(pageSize), _padding(padding)
+{
+}
+
+TextureAtlas::~TextureAtlas()
+{
+    if (!_textures.empty())
+        GLState::deleteTextures(_textures.size(), _textures.data());
+}
+
+int TextureAtlas::addRegion(const std::string &name, int page, int x, int y, int width, int height)
+{
+    AtlasRegion region;
+    region.page = page;
+    region.x = x;
+    region.y = y;
+    region.width = width;
+    region.height = height;
+    region.uv[0] = (float) x / _pageSize;
+    region.uv[1] = (float) y / _pageSize;
+    region.uv[2] = (float) (x + width) / _pageSize;
+    region.uv[3] = (float) (y + height) / _pageSize;
+
+    int index = (int) _regions.size();
+    _regions.push_back(region);
+    _names.push_back(name);
+    _lookup[name] = index;
+    return index;
+}
+
+int TextureAtlas::add(const std::string &name, const unsigned char* pixels, int width, int height, int channels)
+{
+    int paddedWidth = width + 2 * _padding;
+    int paddedHeight = height + 2 * _padding;
+    if (paddedWidth > _pageSize || paddedHeight > _pageSize || channels < 1 || channels > 4)
+    {
+        std::cout << "ERROR::TEXTURE_ATLAS::IMAGE_TOO_LARGE " << name << std::endl;
+        return -1;
+    }
+
+    int page = -1;
+    int x = 0, y = 0;
+    for (size_t i = 0; i < _packers.size() && page < 0; i++)
+        if (_packers[i].insert(paddedWidth, paddedHeight, x, y))
+            page = (int) i;
+
+    if (page < 0)
+    {
+        page = (int) _packers.size();
+        _packers.emplace_back(_pageSize, _pageSize);
+        _pages.emplace_back((size_t) _pageSize * _pageSize * 4, 0);
+        _dirty.push_back(true);
+        _packers.back().insert(paddedWidth, paddedHeight, x, y);
+    }
+
+    int index = addRegion(name, page, x + _padding, y + _padding, width, height);
+    blit(_regions[index], pixels, channels);
+    _dirty[page] = true;
+    return index;
+}
+
+void TextureAtlas::blit(const AtlasRegion &region, const unsigned char* pixels, int channels)
+{
+    unsigned char* page = _pages[region.page].data();
+    int width = region.width;
+
+    // Rows above and below reuse the nearest edge row (clamped source row)
+    for (int y = -_padding; y < region.height + _padding; y++)
+    {
+        int sy = std::min(std::max(y, 0), region.height - 1);
+        const unsigned char* in = pixels + (size_t) sy * width * channels;
+        unsigned char* row = page + ((size_t) (region.y + y) * _pageSize + region.x) * 4;
+
+        if (channels == 4)
+            std::memcpy(row, in, (size_t) width * 4);
+        else
+        {
+            // Gray (and gray + alpha) spread to RGB, missing alpha is opaque
+            for (int x = 0; x < width; x++, in += channels)
+            {
+                row[x * 4 + 0] = in[0];
+                row[x * 4 + 1] = channels >= 3 ? in[1] : in[0];
+                row[x * 4 + 2] = channels >= 3 ? in[2] : in[0];
+                row[x * 4 + 3] = channels == 2 ? in[1] : 255;
+            }
+        }
+
+        // Left and right padding repeat the edge pixels
+        for (int x = 1; x <= _padding; x++)
+        {
+            std::memcpy(row - x * 4, row, 4);
+            std::memcpy(row + (width - 1 + x) * 4, row + (width - 1) * 4, 4);
+        }
+    }
+}
+
+int TextureAtlas::addFile(const char* path, bool flipVertically)
+{
+    stbi_set_flip_vertically_on_load_thread(flipVertically);
+
+    int width, height, channels;
+    unsigned char* data = stbi_load(path, &width, &height, &channels, 0);
+    if (!data)
+    {
+        std::cout << "ERROR::TEXTURE_ATLAS::LOAD_FAILED " << path << std::endl;
+        return -1;
+    }
+
+    int index = add(path, data, width, height, channels);
+    stbi_image_free(data);
+    return index;
+}
+
+void TextureAtlas::upload()
+{
+    while (_textures.size() < _pages.size())
+    {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        GLState::bindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        _textures.push_back(texture);
+    }
+
+    for (size_t i = 0; i < _pages.size(); i++)
+    {
+        if (!_dirty[i])
+            continue;
+
+        GLState::bindTexture(GL_TEXTURE_2D, _textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, _pageSize, _pageSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, _pages[i].data());
+        _dirty[i] = false;
+    }
+}
+
+bool TextureAtlas::write(const std::string &prefix) const
+{
+    for (size_t i = 0; i < _pages.size(); i++)
+    {
+        if (_pages[i].empty())
+        {
+            std::cout << "ERROR::TEXTURE_ATLAS::PAGE_NOT_IN_MEMORY " << i << std::endl;
+            return false;
+        }
+
+        MipLevel level { _pageSize, _pageSize, _pages[i] };
+        std::string path = prefix + "_" + std::to_string(i) + ".txb";
+        if (!TextureFile::write(path.c_str(), { level }, 4))
+            return false;
+    }
+
+    std::ofstream file(prefix + ".atlas");
+    file << "atlas " << _pageSize << " " << _pages.size() << "\n";
+    for (size_t i = 0; i < _regions.size(); i++)
+    {
+        const AtlasRegion &r = _regions[i];
+        file << r.page << " " << r.x << " " << r.y << " " << r.width << " " << r.height << " " << _names[i] << "\n";
+    }
+    return (bool) file;
+}
+
+bool TextureAtlas::load(const std::string &prefix)
+{
+    // Everything is read and checked into locals first; the atlas only
+    // changes once the whole file and every page turned out good
+    std::ifstream file(prefix + ".atlas");
+    std::string magic;
+    int pageSize = 0;
+    size_t pageCount = 0;
+    std::vector<AtlasRegion> regions;
+    std::vector<std::string> names;
+    bool good = (file >> magic >> pageSize >> pageCount) && magic == "atlas" && pageSize > 0
+        && pageCount <= (size_t) INT_MAX;
+
+    std::string line;
+    std::getline(file, line);
+    while (good && std::getline(file, line))
+    {
+        std::istringstream fields(line);
+        AtlasRegion region;
+        std::string name;
+        if (!(fields >> region.page >> region.x >> region.y >> region.width >> region.height))
+            continue;
+        std::getline(fields >> std::ws, name);
+        good = region.page >= 0 && (size_t) region.page < pageCount
+            && region.x >= 0 && region.width >= 0 && region.x <= pageSize - region.width
+            && region.y >= 0 && region.height >= 0 && region.y <= pageSize - region.height;
+        regions.push_back(region);
+        names.push_back(name);
+    }
+
+    // The old pages go either way: on failure the atlas is left empty
+    if (!_textures.empty())
+        GLState::deleteTextures(_textures.size(), _textures.data());
+    _textures.clear();
+    _packers.clear();
+    _pages.clear();
+    _dirty.clear();
+    _regions.clear();
+    _names.clear();
+    _lookup.clear();
+
+    if (!good)
+    {
+        std::cout << "ERROR::TEXTURE_ATLAS::BAD_REGION_FILE " << prefix << ".atlas" << std::endl;
+        return false;
+    }
+
+    std::vector<GLuint> textures;
+    for (size_t i = 0; i < pageCount; i++)
+    {
+        std::string path = prefix + "_" + std::to_string(i) + ".txb";
+        TextureFile page { path.c_str() };
+        if (!page.valid() || (int) page.header().width != pageSize || (int) page.header().height != pageSize)
+        {
+            std::cout << "ERROR::TEXTURE_ATLAS::BAD_PAGE " << path << std::endl;
+            if (!textures.empty())
+                GLState::deleteTextures(textures.size(), textures.data());
+            return false;
+        }
+
+        GLuint texture;
+        glGenTextures(1, &texture);
+        GLState::bindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+        // Straight from the mapping, no intermediate copy
+        page.upload(GL_TEXTURE_2D);
+        textures.push_back(texture);
+    }
+
+    _pageSize = pageSize;
+    _textures.swap(textures);
+
+    // Loaded pages are closed: each gets a packer that's already full,
+    // so later add() calls open new pages
+    _packers.assign(pageCount, SkylinePacker(_pageSize, _pageSize));
+    for (SkylinePacker &packer : _packers)
+    {
+        int x, y;
+        packer.insert(_pageSize, _pageSize, x, y);
+    }
+    _pages.assign(pageCount, std::vector<unsigned char>());
+    _dirty.assign(pageCount, false);
+
+    for (size_t i = 0; i < regions.size(); i++)
+    {
+        const AtlasRegion &r = regions[i];
+        addRegion(names[i], r.page, r.x, r.y, r.width, r.height);
+    }
+    return true;
+}
+
+int TextureAtlas::find(const std::string &name) const
+{
+    auto it = _lookup.find(name);
+    return it == _lookup.end() ? -1 : it->second;
+}
+
+void TextureAtlas::remapUV(int index, float &u, float &v) const
+{
+    const float* uv = _regions[index].uv;
+    u = uv[0] + u * (uv[2] - uv[0]);
+    v = uv[1] + v * (uv[3] - uv[1]);
+}
+
+float TextureAtlas::occupancy() const
+{
+    long long used = 0;
+    long long area = 0;
+    for (const AtlasRegion &region : _regions)
+        used += (long long) region.width * region.height;
+    for (const SkylinePacker &packer : _packers)
+        area += (long long) _pageSize * packer.usedHeight();
+    return area > 0 ? (float) ((double) used / area) : 0.0f;
+}
@@ -0,0 +1,129 @@
+#ifndef TEXTURE_ATLAS_H_
+#define TEXTURE_ATLAS_H_
+
+#include <glad/glad.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Skyline bottom-left rectangle packer for one page. The skyline is the
+// top edge of everything placed so far; each rectangle goes where it ends
+// up lowest, which keeps wasted space under it small.
+class SkylinePacker
+{
+    struct Node
+    {
+        int x;
+        int y;
+        int width;
+    };
+
+    int _width;
+    int _height;
+    long long _usedArea = 0;
+    std::vector<Node> _skyline;
+
+    // Top the rectangle would have if placed at node index, -1 if it can't
+    int fit(size_t index, int width, int height) const;
+
+    public:
+        SkylinePacker(int width, int height);
+
+        // Finds a spot for a width x height rectangle, false if the page is full
+        bool insert(int width, int height, int &x, int &y);
+
+        void clear();
+
+        // Share of the page covered by rectangles, 0 to 1
+        float occupancy() const { return (float) ((double) _usedArea / ((double) _width * _height)); }
+
+        // Top of the highest rectangle so far
+        int usedHeight() const;
+};
+
+// Where an image ended up in the atlas
+struct AtlasRegion
+{
+    int page;
+    int x;
+    int y;
+    int width;
+    int height;
+    float uv[4]; // u0, v0, u1, v1 of the image inside its page
+};
+
+// Packs many small images into a few large RGBA8 pages, so everything on
+// one page draws with a single texture bind.
+//
+// Images keep their row order, so ones loaded flipped (as the samples do)
+// stay the right way up and a quad's (0,0)-(1,1) texture coordinates map
+// to the region with remapUV(). Each image gets a border of its own edge
+// pixels, so linear filtering at region edges never picks up a neighbour.
+// Pages have no mipmaps: small levels would blend regions together.
+//
+// Pages can also be baked offline (tools/atlasbake) and loaded back with
+// load(), skipping decoding and packing at startup.
+class TextureAtlas
+{
+    int _pageSize;
+    int _padding;
+    std::vector<SkylinePacker> _packers;
+    std::vector<GLuint> _textures;
+
+    // CPU copy of each page, and whether it changed since the last upload.
+    // Pages that came from load() have no copy and are never written again.
+    std::vector<std::vector<unsigned char>> _pages;
+    std::vector<bool> _dirty;
+    std::vector<AtlasRegion> _regions;
+    std::vector<std::string> _names;
+    std::unordered_map<std::string, int> _lookup;
+
+    int addRegion(const std::string &name, int page, int x, int y, int width, int height);
+    void blit(const AtlasRegion &region, const unsigned char* pixels, int channels);
+
+    public:
+        // A square pageSize pixels wide; padding is the border per image
+        explicit TextureAtlas(int pageSize = 2048, int padding = 1);
+        ~TextureAtlas();
+
+        TextureAtlas(const TextureAtlas&) = delete;
+        TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+        // Copies an 8-bit image with 1 to 4 channels into a page and returns
+        // its region index, or -1 if it can't fit on a page at all.
+        // Packing is tighter when images come in order of decreasing height.
+        int add(const std::string &name, const unsigned char* pixels, int width, int height, int channels);
+
+        // Decodes the file with stb_image first
+        int addFile(const char* path, bool flipVertically = true);
+
+        // Creates a GL texture for every new page and refreshes changed ones
+        void upload();
+
+        // Writes prefix_N.txb for every page and a prefix.atlas region list
+        bool write(const std::string &prefix) const;
+
+        // Reads a prefix.atlas and its pages back and uploads them. Replaces
+        // whatever the atlas held before; if anything in the files is bad
+        // it returns false and leaves the atlas empty.
+        bool load(const std::string &prefix);
+
+        // Region index for a name given to add(), -1 if there's none
+        int find(const std::string &name) const;
+
+        const AtlasRegion& region(int index) const { return _regions[index]; }
+        size_t regionCount() const { return _regions.size(); }
+
+        // Maps texture coordinates over the whole image into the atlas page
+        void remapUV(int index, float &u, float &v) const;
+
+        size_t pageCount() const { return _pages.size(); }
+        GLuint pageTexture(int page) const { return _textures[page]; }
+
+        // Packing efficiency, 0 to 1: image pixels (without padding) over
+        // the page area up to the top of what's placed on each page
+        float occupancy() const;
+};
+
+#endif // TEXTURE_ATLAS_H_
@@ -0,0 +1,179 @@
+#include "texture_cache.hpp"
+#include "gl_state.hpp"
+#include <filesystem>
+#include <utility>
+
+TextureHandle::TextureHandle(TextureCache* cache, TextureCacheEntry* entry)
+    : _cache(cache), _entry(entry)
+{
+    _cache->retain(_entry);
+}
+
+TextureHandle::TextureHandle(const TextureHandle &other)
+    : _cache(other._cache), _entry(other._entry)
+{
+    if (_entry)
+        _cache->retain(_entry);
+}
+
+TextureHandle::TextureHandle(TextureHandle &&other) noexcept
+    : _cache(std::exchange(other._cache, nullptr)),
+      _entry(std::exchange(other._entry, nullptr))
+{
+}
+
+TextureHandle& TextureHandle::operator=(TextureHandle other) noexcept
+{
+    std::swap(_cache, other._cache);
+    std::swap(_entry, other._entry);
+    return *this;
+}
+
+TextureHandle::~TextureHandle()
+{
+    if (_entry)
+        _cache->release(_entry);
+}
+
+GLuint TextureHandle::id() const
+{
+    return _entry ? _entry->texture : 0;
+}
+
+void TextureHandle::bind(unsigned unit) const
+{
+    if (_entry)
+        _cache->touch(_entry);
+
+    GLState::activeTexture(GL_TEXTURE0 + unit);
+    GLState::bindTexture(GL_TEXTURE_2D, id());
+}
+
+TextureCache::TextureCache(TextureLoader &loader, size_t budget)
+    : _loader(loader), _budget(budget)
+{
+}
+
+TextureCache::~TextureCache()
+{
+    // Anything left has outstanding handles, which is a bug on the caller's
+    // side, but the GL memory still shouldn't leak
+    for (auto &pair : _entries)
+        if (pair.second->texture != 0)
+            _loader.discard(pair.second->texture);
+}
+
+TextureHandle TextureCache::get(const char* path, const SamplerState &sampler, bool flipVertically)
+{
+    std::error_code ec;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(path, ec);
+    std::string key = (ec ? std::string(path) : canonical.string())
+                    + "|" + std::to_string(sampler.wrapS) + "," + std::to_string(sampler.wrapT)
+                    + "," + std::to_string(sampler.minFilter) + "," + std::to_string(sampler.magFilter)
+                    + (flipVertically ? "|flip" : "");
+
+    auto it = _entries.find(key);
+    if (it != _entries.end())
+        return TextureHandle(this, it->second.get());
+
+    std::unique_ptr<Entry> entry(new Entry);
+    entry->key = key;
+    entry->path = path;
+    entry->sampler = sampler;
+    entry->flipVertically = flipVertically;
+    entry->lastUsedFrame = _frame;
+    entry->lru = _lru.insert(_lru.begin(), entry.get());
+
+    Entry* raw = entry.get();
+    _entries.emplace(key, std::move(entry));
+    startLoad(raw);
+
+    return TextureHandle(this, raw);
+}
+
+void TextureCache::startLoad(Entry* entry)
+{
+    entry->texture = _loader.load(entry->path.data(), entry->flipVertically, [this, entry](GLuint, size_t bytes) {
+        entry->bytes = bytes;
+        entry->reloading = false;
+        _residentBytes += bytes;
+        enforceBudget();
+    });
+
+    // load() leaves the new texture bound
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, entry->sampler.wrapS);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, entry->sampler.wrapT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, entry->sampler.minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, entry->sampler.magFilter);
+}
+
+void TextureCache::touch(Entry* entry)
+{
+    entry->lastUsedFrame = _frame;
+    _lru.splice(_lru.begin(), _lru, entry->lru);
+
+    if (entry->texture == 0)
+    {
+        entry->reloading = true;
+        startLoad(entry);
+        _stats.reloads++;
+    }
+
+    if (entry->reloading)
+        _stats.reloadStalls++;
+}
+
+void TextureCache::evict(Entry* entry)
+{
+    // discard() keeps the upload callback from running if it's in flight
+    _loader.discard(entry->texture);
+    _residentBytes -= entry->bytes;
+    entry->texture = 0;
+    entry->bytes = 0;
+    entry->reloading = false;
+    _stats.evictions++;
+}
+
+void TextureCache::enforceBudget()
+{
+    if (_budget == 0)
+        return;
+
+    for (auto it = _lru.rbegin(); it != _lru.rend() && _residentBytes > _budget; ++it)
+    {
+        Entry* entry = *it;
+
+        // Everything from here on was used this frame, and is needed
+        if (entry->lastUsedFrame == _frame)
+            break;
+
+        if (entry->texture != 0 && entry->bytes > 0)
+            evict(entry);
+    }
+}
+
+void TextureCache::beginFrame()
+{
+    _frame++;
+    enforceBudget();
+}
+
+void TextureCache::setBudget(size_t bytes)
+{
+    _budget = bytes;
+    enforceBudget();
+}
+
+void TextureCache::release(Entry* entry)
+{
+    if (--entry->refs > 0)
+        return;
+
+    // discard() keeps the upload callback from ever running for a texture
+    // still in flight, so it can't touch the entry after this
+    if (entry->texture != 0)
+        _loader.discard(entry->texture);
+    _residentBytes -= entry->bytes;
+    _lru.erase(entry->lru);
+    _entries.erase(entry->key);
+}
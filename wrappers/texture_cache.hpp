@@ -0,0 +1,137 @@
+#ifndef TEXTURE_CACHE_H_
+#define TEXTURE_CACHE_H_
+
+#include "texture_loader.hpp"
+
+#include <glad/glad.h>
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// Wrapping and filtering a cached texture is created with. Part of the
+// cache key, since the same image with different sampling needs its own
+// texture object (there are no sampler objects in these samples).
+struct SamplerState
+{
+    GLint wrapS = GL_REPEAT;
+    GLint wrapT = GL_REPEAT;
+    GLint minFilter = GL_LINEAR_MIPMAP_LINEAR;
+    GLint magFilter = GL_LINEAR;
+};
+
+class TextureCache;
+struct TextureCacheEntry;
+
+// Shared reference to a cached texture. The GL texture is freed once the
+// last handle to it goes away. Handles must not outlive their cache.
+class TextureHandle
+{
+    friend class TextureCache;
+
+    TextureCache* _cache = nullptr;
+    TextureCacheEntry* _entry = nullptr;
+
+    TextureHandle(TextureCache* cache, TextureCacheEntry* entry);
+
+    public:
+        TextureHandle() = default;
+        TextureHandle(const TextureHandle &other);
+        TextureHandle(TextureHandle &&other) noexcept;
+        TextureHandle& operator=(TextureHandle other) noexcept;
+        ~TextureHandle();
+
+        explicit operator bool() const { return _entry != nullptr; }
+
+        GLuint id() const;
+
+        // glActiveTexture(GL_TEXTURE0 + unit) + glBindTexture
+        void bind(unsigned unit) const;
+};
+
+// Loads each (file, sampler) pair once and hands out shared handles to it.
+// Paths are canonicalized, so "./a.png" and "a.png" share one texture.
+//
+// With a memory budget set, it also manages residency: textures that
+// haven't been bound lately are evicted from the GPU when over budget and
+// reloaded through the loader (placeholder first) when bound again.
+// Handles stay valid across eviction, but id() may change, so don't hold
+// on to raw texture names.
+struct TextureCacheEntry
+{
+    std::string key;
+    std::string path;
+    SamplerState sampler;
+    bool flipVertically;
+
+    GLuint texture = 0; // 0 while evicted
+    size_t bytes = 0;   // 0 until the loader uploads the real image
+    unsigned refs = 0;
+    bool reloading = false;
+    unsigned long long lastUsedFrame = 0;
+    std::list<TextureCacheEntry*>::iterator lru;
+};
+
+class TextureCache
+{
+    friend class TextureHandle;
+
+    typedef TextureCacheEntry Entry;
+
+    public:
+        struct Stats
+        {
+            unsigned evictions = 0;
+            unsigned reloads = 0;      // evicted textures that were needed again
+            unsigned reloadStalls = 0; // binds that got a placeholder while reloading
+        };
+
+    private:
+    TextureLoader &_loader;
+    std::unordered_map<std::string, std::unique_ptr<Entry>> _entries;
+    size_t _residentBytes = 0;
+
+    // Most recently used first. Eviction walks it from the back.
+    std::list<Entry*> _lru;
+    size_t _budget;
+    unsigned long long _frame = 1;
+    Stats _stats;
+
+    void retain(Entry* entry) { entry->refs++; }
+    void release(Entry* entry);
+
+    // Marks the entry used this frame, reloading it if it was evicted
+    void touch(Entry* entry);
+    void startLoad(Entry* entry);
+    void evict(Entry* entry);
+    void enforceBudget();
+
+    public:
+        // budget is in bytes, 0 means unlimited
+        explicit TextureCache(TextureLoader &loader, size_t budget = 0);
+        ~TextureCache();
+
+        TextureCache(const TextureCache&) = delete;
+        TextureCache& operator=(const TextureCache&) = delete;
+
+        // Returns the cached texture, or starts loading it through the loader
+        TextureHandle get(const char* path, const SamplerState &sampler = SamplerState(), bool flipVertically = true);
+
+        // Call once per frame. Textures bound during the current frame are
+        // never evicted, everything else goes least recently used first
+        // whenever residentBytes() is over budget.
+        void beginFrame();
+
+        void setBudget(size_t bytes);
+        size_t budget() const { return _budget; }
+
+        // GPU memory held by uploaded textures, all mip levels included
+        size_t residentBytes() const { return _residentBytes; }
+        const Stats& stats() const { return _stats; }
+
+        // Distinct textures currently alive
+        size_t size() const { return _entries.size(); }
+};
+
+#endif // TEXTURE_CACHE_H_
@@ -0,0 +1,129 @@
+#include "texture_file.hpp"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    const char fileMagic[4] = { 'T', 'X', 'B', '1' };
+    const std::uint32_t fileVersion = 1;
+
+    // What write() produces, by channel count
+    const GLenum fileFormats[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+    const GLenum fileInternalFormats[] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+
+    std::uint64_t alignUp(std::uint64_t value)
+    {
+        return (value + 15) & ~(std::uint64_t) 15;
+    }
+
+    // Channels of a format write() produces, 0 for anything else
+    int fileChannels(const TextureFileHeader &header)
+    {
+        if (header.type != GL_UNSIGNED_BYTE)
+            return 0;
+        for (int i = 0; i < 4; i++)
+            if (header.format == fileFormats[i] && header.internalFormat == fileInternalFormats[i])
+                return i + 1;
+        return 0;
+    }
+}
+
+TextureFile::TextureFile(const char* path)
+    : _file(path, true)
+{
+    if (!_file.valid() || _file.size() < sizeof(TextureFileHeader))
+        return;
+
+    const TextureFileHeader* header = (const TextureFileHeader*) _file.data();
+    if (std::memcmp(header->magic, fileMagic, 4) != 0 || header->version != fileVersion
+        || header->levelCount == 0 || header->levelCount > (std::uint32_t) TextureFileHeader::maxLevels
+        || fileChannels(*header) == 0)
+    {
+        std::cout << "ERROR::TEXTURE_FILE::BAD_HEADER\n" << path << std::endl;
+        return;
+    }
+
+    // upload() hands GL width * height * channels bytes from each offset,
+    // so every one of them has to be in the file. Written as a
+    // subtraction, since offset + size could wrap.
+    int channels = fileChannels(*header);
+    for (std::uint32_t i = 0; i < header->levelCount; i++)
+    {
+        const TextureFileLevel &level = header->levels[i];
+        if (level.size != (std::uint64_t) level.width * level.height * channels)
+        {
+            std::cout << "ERROR::TEXTURE_FILE::BAD_LEVEL\n" << path << ": level " << i << std::endl;
+            return;
+        }
+        if (level.offset > _file.size() || level.size > _file.size() - level.offset)
+        {
+            std::cout << "ERROR::TEXTURE_FILE::TRUNCATED\n" << path << std::endl;
+            return;
+        }
+    }
+
+    _header = header;
+}
+
+void TextureFile::upload(GLenum target) const
+{
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (std::uint32_t i = 0; i < _header->levelCount; i++)
+    {
+        const TextureFileLevel &level = _header->levels[i];
+        glTexImage2D(target, i, _header->internalFormat, level.width, level.height, 0,
+                     _header->format, _header->type, levelData(i));
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    // Let sampling use exactly the levels we have
+    glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, _header->levelCount - 1);
+}
+
+bool TextureFile::write(const char* path, const std::vector<MipLevel> &levels, int channels)
+{
+    if (levels.empty() || levels.size() > (size_t) TextureFileHeader::maxLevels || channels < 1 || channels > 4)
+        return false;
+
+    TextureFileHeader header = {};
+    std::memcpy(header.magic, fileMagic, 4);
+    header.version = fileVersion;
+    header.internalFormat = fileInternalFormats[channels - 1];
+    header.format = fileFormats[channels - 1];
+    header.type = GL_UNSIGNED_BYTE;
+    header.width = levels[0].width;
+    header.height = levels[0].height;
+    header.levelCount = (std::uint32_t) levels.size();
+
+    std::uint64_t offset = alignUp(sizeof(TextureFileHeader));
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        header.levels[i].offset = offset;
+        header.levels[i].size = levels[i].pixels.size();
+        header.levels[i].width = levels[i].width;
+        header.levels[i].height = levels[i].height;
+        offset = alignUp(offset + levels[i].pixels.size());
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write((const char*) &header, sizeof(header));
+
+    const char padding[16] = {};
+    std::uint64_t written = sizeof(header);
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        file.write(padding, header.levels[i].offset - written);
+        file.write((const char*) levels[i].pixels.data(), levels[i].pixels.size());
+        written = header.levels[i].offset + levels[i].pixels.size();
+    }
+
+    return (bool) file;
+}
+
+bool TextureFile::isTextureFile(const char* path)
+{
+    size_t length = std::strlen(path);
+    return length >= 4 && std::strcmp(path + length - 4, ".txb") == 0;
+}
@@ -0,0 +1,69 @@
+#ifndef TEXTURE_FILE_H_
+#define TEXTURE_FILE_H_
+
+#include "mapped_file.hpp"
+#include "mipmap.hpp"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <vector>
+
+// Baked texture container (.txb), written offline by tools/texbake.
+// A fixed-size header is followed by every mip level, already in the GL
+// format it gets uploaded with, rows tightly packed, each level starting
+// on a 16 byte boundary:
+//
+//     TextureFileHeader | level 0 | level 1 | ... | level N-1
+//
+// Loading is an mmap plus one glTexImage2D per level straight from the
+// mapping, with no decoding and no glGenerateMipmap.
+struct TextureFileLevel
+{
+    std::uint64_t offset; // from the start of the file
+    std::uint64_t size;
+    std::uint32_t width;
+    std::uint32_t height;
+};
+
+struct TextureFileHeader
+{
+    static const int maxLevels = 16;
+
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t internalFormat;
+    std::uint32_t format;
+    std::uint32_t type;
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t levelCount;
+    TextureFileLevel levels[maxLevels];
+};
+
+class TextureFile
+{
+    MappedFile _file;
+    const TextureFileHeader* _header = nullptr;
+
+    public:
+        TextureFile() = default;
+
+        // Maps and validates the file, check valid() afterwards
+        explicit TextureFile(const char* path);
+
+        bool valid() const { return _header != nullptr; }
+        const TextureFileHeader& header() const { return *_header; }
+        const unsigned char* levelData(int level) const { return _file.data() + _header->levels[level].offset; }
+
+        // glTexImage2D every level into the texture bound to target
+        void upload(GLenum target) const;
+
+        // Writes a chain of 8-bit levels with 1 to 4 channels
+        static bool write(const char* path, const std::vector<MipLevel> &levels, int channels);
+
+        // True for paths ending in .txb
+        static bool isTextureFile(const char* path);
+};
+
+#endif // TEXTURE_FILE_H_
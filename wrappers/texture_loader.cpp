@@ -0,0 +1,200 @@
+#include "texture_loader.hpp"
+#include "gl_state.hpp"
+#include <stb_image.h>
+#include <iostream>
+#include <string>
+
+namespace
+{
+    GLenum formatForChannels(int channels)
+    {
+        switch (channels)
+        {
+            case 1: return GL_RED;
+            case 2: return GL_RG;
+            case 3: return GL_RGB;
+            default: return GL_RGBA;
+        }
+    }
+
+    GLenum internalFormatForChannels(int channels)
+    {
+        switch (channels)
+        {
+            case 1: return GL_R8;
+            case 2: return GL_RG8;
+            case 3: return GL_RGB8;
+            default: return GL_RGBA8;
+        }
+    }
+}
+
+TextureLoader::TextureLoader(unsigned threads)
+    : _pool(threads), _decoded(256)
+{
+}
+
+TextureLoader::~TextureLoader()
+{
+    // Let workers drop their results instead of waiting on a full queue
+    _stopping = true;
+    _pool.wait();
+
+    DecodedImage* image;
+    while (_decoded.pop(image))
+    {
+        stbi_image_free(image->data);
+        delete image;
+    }
+}
+
+GLuint TextureLoader::load(const char* path, bool flipVertically, UploadCallback onUploaded)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    GLState::bindTexture(GL_TEXTURE_2D, texture);
+
+    // Adjust parameters like wrapping and filtering
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // 1x1 white placeholder. A single level is a complete mip chain,
+    // so sampling it is valid even with a mipmapped min filter.
+    const unsigned char white[4] = { 255, 255, 255, 255 };
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+
+    _inFlight++;
+    _pending.insert(texture);
+    std::string file = path;
+    _pool.submit([this, texture, file, flipVertically, onUploaded] {
+        DecodedImage* image = new DecodedImage{ texture, 0, 0, 0, nullptr, {}, TextureFile(), onUploaded };
+
+        if (TextureFile::isTextureFile(file.data()))
+        {
+            // Already flipped and mipmapped at bake time
+            image->baked = TextureFile(file.data());
+            if (!image->baked.valid())
+                std::cout << "Failed to load texture! (" << file << ")" << std::endl;
+        }
+        else
+        {
+            // Images are normally top-down ((0,0) at the top left of the screen),
+            // while OpenGL expects (0,0) to be at the bottom left. So we flip the image.
+            // The per-thread flag keeps workers from racing on the global one.
+            stbi_set_flip_vertically_on_load_thread(flipVertically);
+            image->data = stbi_load(file.data(), &image->width, &image->height, &image->channels, 0);
+            if (!image->data)
+                std::cout << "Failed to load texture! (" << file << ")" << std::endl;
+            else
+            {
+                MipOptions options;
+                options.pool = &_pool;
+                image->mips = buildMipLevels(image->data, image->width, image->height, image->channels, options);
+            }
+        }
+
+        // The GL thread might be busy for a while, so spin politely
+        while (!_decoded.push(image))
+        {
+            if (_stopping)
+            {
+                stbi_image_free(image->data);
+                delete image;
+                return;
+            }
+            std::this_thread::yield();
+        }
+    });
+
+    return texture;
+}
+
+size_t TextureLoader::pump(size_t maxUploads)
+{
+    size_t uploaded = 0;
+    DecodedImage* image;
+    while (uploaded < maxUploads && _decoded.pop(image))
+    {
+        _pending.erase(image->texture);
+        if (_discarded.erase(image->texture))
+        {
+            GLState::deleteTextures(1, &image->texture);
+        }
+        else
+        {
+            size_t bytes = upload(image);
+            if (image->onUploaded)
+                image->onUploaded(image->texture, bytes);
+        }
+
+        stbi_image_free(image->data);
+        delete image;
+        _inFlight--;
+        uploaded++;
+    }
+    return uploaded;
+}
+
+void TextureLoader::discard(GLuint texture)
+{
+    if (_pending.count(texture))
+        _discarded.insert(texture);
+    else
+        GLState::deleteTextures(1, &texture);
+}
+
+void TextureLoader::finish()
+{
+    while (inFlight() > 0)
+    {
+        if (pump() == 0)
+            std::this_thread::yield();
+    }
+}
+
+size_t TextureLoader::upload(DecodedImage* image)
+{
+    if (image->baked.valid())
+    {
+        // Zero copies on our side, GL reads the levels from the mapping
+        GLState::bindTexture(GL_TEXTURE_2D, image->texture);
+        image->baked.upload(GL_TEXTURE_2D);
+
+        size_t bytes = 0;
+        for (std::uint32_t i = 0; i < image->baked.header().levelCount; i++)
+            bytes += image->baked.header().levels[i].size;
+        return bytes;
+    }
+
+    // Failed decodes keep their placeholder
+    if (!image->data)
+        return 0;
+
+    GLState::bindTexture(GL_TEXTURE_2D, image->texture);
+
+    // Rows of 1 and 3 channel images aren't 4-byte aligned in general
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    GLint internalFormat = internalFormatForChannels(image->channels);
+    GLenum format = formatForChannels(image->channels);
+
+    // This pumps the image data into the GPU, staged through the unpack ring
+    GLsizeiptr size = (GLsizeiptr) image->width * image->height * image->channels;
+    size_t bytes = size;
+    _uploads.texImage2D(GL_TEXTURE_2D, 0, internalFormat, image->width, image->height,
+                        format, GL_UNSIGNED_BYTE, image->data, size);
+
+    // The rest of the chain was already built on the worker
+    for (size_t i = 0; i < image->mips.size(); i++)
+    {
+        const MipLevel &level = image->mips[i];
+        _uploads.texImage2D(GL_TEXTURE_2D, (GLint) i + 1, internalFormat, level.width, level.height,
+                            format, GL_UNSIGNED_BYTE, level.pixels.data(), (GLsizeiptr) level.pixels.size());
+        bytes += level.pixels.size();
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint) image->mips.size());
+    return bytes;
+}
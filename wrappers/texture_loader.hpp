@@ -0,0 +1,86 @@
+#ifndef TEXTURE_LOADER_H_
+#define TEXTURE_LOADER_H_
+
+#include "mipmap.hpp"
+#include "mpmc_queue.hpp"
+#include "pixel_upload_ring.hpp"
+#include "texture_file.hpp"
+#include "thread_pool.hpp"
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <functional>
+#include <unordered_set>
+#include <vector>
+
+// Decodes images on a pool of worker threads and uploads them on the GL
+// thread. load() hands back a texture name right away, with a 1x1
+// placeholder in it until the real image arrives, so the first frame never
+// waits on stb_image.
+//
+//     TextureLoader loader;
+//     GLuint tex = loader.load("container.jpg");
+//     while (running) { loader.pump(); /* draw with tex */ }
+class TextureLoader
+{
+    public:
+        // Runs on the GL thread once a texture's real image is in place, with
+        // its size in bytes across all levels (0 if loading failed)
+        typedef std::function<void(GLuint texture, size_t bytes)> UploadCallback;
+
+    private:
+    // Result of one decode, handed from a worker to the GL thread
+    struct DecodedImage
+    {
+        GLuint texture;
+        int width;
+        int height;
+        int channels;
+        unsigned char* data; // stb_image buffer, null if decoding failed
+        std::vector<MipLevel> mips; // levels 1..N, built on the worker
+        TextureFile baked;   // set instead of data for .txb files
+        UploadCallback onUploaded;
+    };
+
+    ThreadPool _pool;
+    MPMCQueue<DecodedImage*> _decoded;
+    PixelUploadRing _uploads;
+    std::atomic<size_t> _inFlight{0};
+    std::atomic<bool> _stopping{false};
+
+    // GL thread only: textures still waiting on a worker, and the ones
+    // among them that were discarded in the meantime
+    std::unordered_set<GLuint> _pending;
+    std::unordered_set<GLuint> _discarded;
+
+    size_t upload(DecodedImage* image);
+
+    public:
+        explicit TextureLoader(unsigned threads = 0);
+        ~TextureLoader();
+
+        // Creates the texture (placeholder bound, REPEAT wrapping, trilinear
+        // filtering) and queues the decode. Must be called on the GL thread.
+        GLuint load(const char* path, bool flipVertically = true, UploadCallback onUploaded = nullptr);
+
+        // Deletes a texture made by load(). If its image is still in flight
+        // the name stays reserved until it arrives, so a later load() can't
+        // be handed the same name and get the old image.
+        void discard(GLuint texture);
+
+        // Uploads up to maxUploads finished images. Call once per frame on
+        // the GL thread. Returns how many were uploaded.
+        size_t pump(size_t maxUploads = (size_t) -1);
+
+        // Blocks until every queued image is decoded and uploaded
+        void finish();
+
+        // Images queued but not uploaded yet
+        size_t inFlight() const { return _inFlight.load(std::memory_order_relaxed); }
+
+        // Throughput of the streaming upload path
+        const PixelUploadRing::Stats& uploadStats() const { return _uploads.stats(); }
+};
+
+#endif // TEXTURE_LOADER_H_
@@ -0,0 +1,107 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+    if (threads == 0)
+    {
+        unsigned cores = std::thread::hardware_concurrency();
+        threads = cores > 1 ? cores - 1 : 1;
+    }
+
+    for (unsigned i = 0; i < threads; i++)
+        _workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_all();
+
+    for (std::thread &worker : _workers)
+        worker.join();
+}
+
+void ThreadPool::submit(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _jobs.push_back(std::move(job));
+    }
+    _wake.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _idle.wait(lock, [this] { return _jobs.empty() && _running == 0; });
+}
+
+void ThreadPool::workerLoop()
+{
+    for (;;)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [this] { return _stopping || !_jobs.empty(); });
+
+            // Drain what is left before stopping, so no job is lost
+            if (_jobs.empty())
+                return;
+
+            job = std::move(_jobs.front());
+            _jobs.pop_front();
+            _running++;
+        }
+
+        job();
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _running--;
+            if (_jobs.empty() && _running == 0)
+                _idle.notify_all();
+        }
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)> &body)
+{
+    struct Range
+    {
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+
+    // Shared, since helpers may only get scheduled after we've returned.
+    // By then every index is taken and they never touch body.
+    auto range = std::make_shared<Range>();
+    auto run = [range, count, &body] {
+        for (size_t i = range->next++; i < count; i = range->next++)
+        {
+            body(i);
+            if (++range->done == count)
+            {
+                std::lock_guard<std::mutex> lock(range->mutex);
+                range->finished.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = std::min(_workers.size(), count > 0 ? count - 1 : 0);
+    for (size_t i = 0; i < helpers; i++)
+        submit(run);
+
+    run();
+
+    std::unique_lock<std::mutex> lock(range->mutex);
+    range->finished.wait(lock, [&] { return range->done == count; });
+}
@@ -0,0 +1,46 @@
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads pulling jobs off a shared queue.
+// Jobs must not touch GL: there is no context on the workers.
+class ThreadPool
+{
+    std::vector<std::thread> _workers;
+    std::deque<std::function<void()>> _jobs;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _idle;
+    size_t _running = 0;
+    bool _stopping = false;
+
+    void workerLoop();
+
+    public:
+        // 0 threads means one per core, minus the main thread
+        explicit ThreadPool(unsigned threads = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        void submit(std::function<void()> job);
+
+        // Blocks until the queue is empty and no job is running
+        void wait();
+
+        // Runs body(i) for every i in [0, count) and returns when all are
+        // done. The calling thread takes indices too, so this is safe to use
+        // from inside a job without deadlocking on a busy pool.
+        void parallelFor(size_t count, const std::function<void(size_t)> &body);
+
+        size_t threadCount() const { return _workers.size(); }
+};
+
+#endif // THREAD_POOL_H_
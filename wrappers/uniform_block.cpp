@@ -0,0 +1,109 @@
+#include "uniform_block.hpp"
+#include "gl_state.hpp"
+#include "shader.hpp"
+#include <cstring>
+#include <iostream>
+
+UniformRing::UniformRing(GLuint binding, GLsizeiptr size, size_t frameCount)
+    : _binding(binding), _size(size), _fences(frameCount, nullptr), _current(frameCount - 1)
+{
+    // glBindBufferRange offsets have to be multiples of this (often 256)
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    _stride = (size + alignment - 1) / alignment * alignment;
+
+    GLsizeiptr total = _stride * (GLsizeiptr) frameCount;
+
+    glGenBuffers(1, &_buffer);
+    GLState::bindBuffer(GL_UNIFORM_BUFFER, _buffer);
+
+    if (glBufferStorage)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_UNIFORM_BUFFER, total, nullptr, flags);
+        _persistent = (unsigned char*) glMapBufferRange(GL_UNIFORM_BUFFER, 0, total, flags);
+
+        // The storage allows plain write maps too, so updates can still
+        // map their slot one at a time
+        if (!_persistent)
+            std::cout << "WARNING::UNIFORM_RING::PERSISTENT_MAP_FAILED\nMapping a slot per update instead"
+                      << std::endl;
+    }
+    else
+    {
+        glBufferData(GL_UNIFORM_BUFFER, total, nullptr, GL_DYNAMIC_DRAW);
+    }
+}
+
+UniformRing::~UniformRing()
+{
+    for (GLsync fence : _fences)
+        if (fence)
+            glDeleteSync(fence);
+
+    if (_persistent)
+    {
+        GLState::bindBuffer(GL_UNIFORM_BUFFER, _buffer);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+    }
+    GLState::deleteBuffers(1, &_buffer);
+}
+
+void UniformRing::update(const void* data)
+{
+    // Every draw that reads the current slot has been issued by now
+    if (_stats.updates > 0)
+        _fences[_current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    _current = (_current + 1) % _fences.size();
+
+    GLsync &fence = _fences[_current];
+    if (fence)
+    {
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        if (result == GL_TIMEOUT_EXPIRED)
+        {
+            _stats.stalls++;
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    GLintptr offset = (GLintptr) _current * _stride;
+    if (_persistent)
+    {
+        std::memcpy(_persistent + offset, data, _size);
+    }
+    else
+    {
+        GLState::bindBuffer(GL_UNIFORM_BUFFER, _buffer);
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+        void* dst = glMapBufferRange(GL_UNIFORM_BUFFER, offset, _size, flags);
+        if (!dst)
+        {
+            // Back to the slot still bound, so draws keep last update's
+            // values. It gets a fresh fence with the next update.
+            std::cout << "ERROR::UNIFORM_RING::MAP_FAILED\nKeeping the previous values" << std::endl;
+            _current = (_current + _fences.size() - 1) % _fences.size();
+            glDeleteSync(_fences[_current]);
+            _fences[_current] = nullptr;
+            return;
+        }
+        std::memcpy(dst, data, _size);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+    }
+
+    GLState::bindBufferRange(GL_UNIFORM_BUFFER, _binding, _buffer, offset, _size);
+    _stats.updates++;
+}
+
+void UniformRing::attach(const Shader &shader, const char* blockName) const
+{
+    GLint size = shader.bindBlock(blockName, _binding);
+    if (size < 0)
+        std::cout << "ERROR::UNIFORM_BLOCK::NOT_FOUND\n" << blockName << std::endl;
+    else if (size > _size)
+        std::cout << "ERROR::UNIFORM_BLOCK::SIZE_MISMATCH\n" << blockName << " is " << size
+                  << " bytes in GLSL but " << _size << " in C++" << std::endl;
+}
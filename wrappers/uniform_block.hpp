@@ -0,0 +1,144 @@
+#ifndef UNIFORM_BLOCK_H_
+#define UNIFORM_BLOCK_H_
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+class Shader;
+
+// Member types that lay out the same in C++ as in a std140 block. Plain
+// float, int and unsigned work as they are. There is deliberately no vec3:
+// std140 packs a scalar right after it, C++ can't, so use a vec4.
+namespace std140
+{
+    struct alignas(8) vec2 { float x, y; };
+    struct alignas(16) vec4 { float x, y, z, w; };
+    struct alignas(16) ivec4 { int x, y, z, w; };
+
+    // Column-major, like GLSL
+    struct alignas(16) mat4 { vec4 columns[4]; };
+
+    // std140 array elements are padded to 16 bytes, so a GLSL
+    // "float weights[8]" is a padded<float> weights[8] here
+    template <typename T>
+    struct alignas(16) padded { T value; };
+}
+
+// Base alignment of a member type under std140. Types without one, like
+// a bare float array or a vec3, don't compile.
+template <typename T> struct Std140Alignment;
+template <> struct Std140Alignment<float> { static constexpr size_t value = 4; };
+template <> struct Std140Alignment<int> { static constexpr size_t value = 4; };
+template <> struct Std140Alignment<unsigned> { static constexpr size_t value = 4; };
+template <> struct Std140Alignment<std140::vec2> { static constexpr size_t value = 8; };
+template <> struct Std140Alignment<std140::vec4> { static constexpr size_t value = 16; };
+template <> struct Std140Alignment<std140::ivec4> { static constexpr size_t value = 16; };
+template <> struct Std140Alignment<std140::mat4> { static constexpr size_t value = 16; };
+template <typename T> struct Std140Alignment<std140::padded<T>> { static constexpr size_t value = 16; };
+
+template <typename T, size_t N>
+struct Std140Alignment<T[N]>
+{
+    static_assert(sizeof(T) % 16 == 0, "std140 array elements take 16 bytes each, use std140::padded<T>");
+    static constexpr size_t value = Std140Alignment<T>::value < 16 ? 16 : Std140Alignment<T>::value;
+};
+
+// Pins a member to the offset the GLSL block gives it, next to the struct:
+//
+//     struct FrameData
+//     {
+//         std140::mat4 viewProjection;
+//         std140::vec2 viewport;
+//         float time;
+//     };
+//     STD140_MEMBER(FrameData, viewProjection, 0);
+//     STD140_MEMBER(FrameData, viewport, 64);
+//     STD140_MEMBER(FrameData, time, 72);
+#define STD140_MEMBER(Block, member, offset) \
+    static_assert(offsetof(Block, member) == (offset), \
+                  #Block "::" #member " is not at offset " #offset); \
+    static_assert((offset) % Std140Alignment<decltype(Block::member)>::value == 0, \
+                  #Block "::" #member " breaks std140 alignment")
+
+// The type-independent part of UniformBlock: one buffer split into
+// frameCount slots, each bound in turn with glBindBufferRange.
+//
+// Writing a slot the GPU may still be reading would stall (or corrupt a
+// draw), so every slot gets a fence once the next one takes over, and is
+// only written again after that fence signals. With three slots the CPU
+// can run two frames ahead before it ever waits.
+//
+// Like PixelUploadRing, the buffer is mapped persistently on GL 4.4 and
+// otherwise mapped per update with GL_MAP_UNSYNCHRONIZED_BIT.
+class UniformRing
+{
+    GLuint _buffer;
+    GLuint _binding;
+    GLsizeiptr _size;
+    GLsizeiptr _stride;
+    std::vector<GLsync> _fences;
+    size_t _current;
+    unsigned char* _persistent = nullptr;
+
+    public:
+        struct Stats
+        {
+            unsigned updates = 0;
+            unsigned stalls = 0; // had to wait for the GPU to free a slot
+        };
+
+        UniformRing(GLuint binding, GLsizeiptr size, size_t frameCount);
+        ~UniformRing();
+
+        UniformRing(const UniformRing&) = delete;
+        UniformRing& operator=(const UniformRing&) = delete;
+
+        // Copies data into the next free slot and binds it
+        void update(const void* data);
+
+        // Hooks a program's block up to this ring's binding point. Warns
+        // when the block the driver sees is bigger than the C++ side.
+        void attach(const Shader &shader, const char* blockName) const;
+
+        GLuint binding() const { return _binding; }
+        bool persistent() const { return _persistent != nullptr; }
+        const Stats& stats() const { return _stats; }
+
+    private:
+        Stats _stats;
+};
+
+// Per-frame data shared by every program through one uniform buffer:
+//
+//     UniformBlock<FrameData> frame { 0 };
+//     frame.attach(shader, "FrameData");
+//     while (running)
+//     {
+//         frame.update(data); // once, before the frame's draws
+//         ...
+//     }
+template <typename T>
+class UniformBlock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "uniform blocks are copied with memcpy");
+    static_assert(std::is_standard_layout<T>::value, "uniform blocks need a predictable layout");
+    static_assert(sizeof(T) % 16 == 0, "std140 rounds a block up to 16 bytes, add padding at the end");
+
+    UniformRing _ring;
+
+    public:
+        explicit UniformBlock(GLuint binding, size_t frameCount = 3)
+            : _ring(binding, sizeof(T), frameCount) {}
+
+        void update(const T &data) { _ring.update(&data); }
+        void attach(const Shader &shader, const char* blockName) const { _ring.attach(shader, blockName); }
+
+        GLuint binding() const { return _ring.binding(); }
+        bool persistent() const { return _ring.persistent(); }
+        const UniformRing::Stats& stats() const { return _ring.stats(); }
+};
+
+#endif // UNIFORM_BLOCK_H_
@@ -0,0 +1,98 @@
+#include "vertex_layout.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    long roundClamped(float value, float low, float high, float scale)
+    {
+        return std::lround(std::min(std::max(value, low), high) * scale);
+    }
+}
+
+std::uint16_t vertex::packHalf(float value)
+{
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    std::uint16_t sign = (std::uint16_t) ((bits >> 16) & 0x8000);
+    std::uint32_t magnitude = bits & 0x7FFFFFFF;
+
+    if (magnitude > 0x7F800000)
+        return sign | 0x7E00; // NaN stays NaN
+    if (magnitude >= 0x477FE000)
+        return sign | 0x7BFF; // 65504 and up, infinity too, clamp to the largest half
+
+    // Below 2^-14 halves are subnormal, counting in steps of 2^-24
+    if (magnitude < 0x38800000)
+    {
+        float absolute;
+        std::memcpy(&absolute, &magnitude, sizeof(absolute));
+        return sign | (std::uint16_t) std::nearbyint(absolute * 16777216.0f);
+    }
+
+    // Rebias the exponent (127 -> 15) and round the mantissa to nearest
+    // even. A carry out of the mantissa bumps the exponent, as it should.
+    std::uint32_t half = (magnitude - 0x38000000) >> 13;
+    std::uint32_t remainder = magnitude & 0x1FFF;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+        half++;
+    return sign | (std::uint16_t) half;
+}
+
+float vertex::unpackHalf(std::uint16_t half)
+{
+    std::uint32_t sign = (std::uint32_t) (half & 0x8000) << 16;
+    std::uint32_t exponent = (half >> 10) & 0x1F;
+    std::uint32_t mantissa = half & 0x3FF;
+
+    std::uint32_t bits;
+    if (exponent == 0)
+    {
+        float value = mantissa / 16777216.0f;
+        std::memcpy(&bits, &value, sizeof(bits));
+        bits |= sign;
+    }
+    else if (exponent == 31)
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    else
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+vertex::half2 vertex::packHalf2(float x, float y)
+{
+    return { packHalf(x), packHalf(y) };
+}
+
+vertex::unorm8x4 vertex::packUnorm8x4(float x, float y, float z, float w)
+{
+    return {
+        (std::uint8_t) roundClamped(x, 0.0f, 1.0f, 255.0f),
+        (std::uint8_t) roundClamped(y, 0.0f, 1.0f, 255.0f),
+        (std::uint8_t) roundClamped(z, 0.0f, 1.0f, 255.0f),
+        (std::uint8_t) roundClamped(w, 0.0f, 1.0f, 255.0f)
+    };
+}
+
+vertex::unorm16x2 vertex::packUnorm16x2(float x, float y)
+{
+    return {
+        (std::uint16_t) roundClamped(x, 0.0f, 1.0f, 65535.0f),
+        (std::uint16_t) roundClamped(y, 0.0f, 1.0f, 65535.0f)
+    };
+}
+
+vertex::snorm10x3 vertex::packSnorm10x3(float x, float y, float z)
+{
+    // GL 4.2+ reads a signed normalized value c as max(c / 511, -1), so
+    // -511..511 covers -1..1 exactly. w (the top 2 bits) stays 0.
+    std::uint32_t bits = 0;
+    bits |= (std::uint32_t) roundClamped(x, -1.0f, 1.0f, 511.0f) & 0x3FF;
+    bits |= ((std::uint32_t) roundClamped(y, -1.0f, 1.0f, 511.0f) & 0x3FF) << 10;
+    bits |= ((std::uint32_t) roundClamped(z, -1.0f, 1.0f, 511.0f) & 0x3FF) << 20;
+    return { bits };
+}
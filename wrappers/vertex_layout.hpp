@@ -0,0 +1,180 @@
+#ifndef VERTEX_LAYOUT_H_
+#define VERTEX_LAYOUT_H_
+
+#include "gl_state.hpp"
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Vertex attribute types, each one a GL attribute format. Besides plain
+// floats there are packed ones that carry the same data in a half or a
+// quarter of the bytes:
+//
+//  - half2/half4: 16-bit floats, plenty for texture coordinates
+//  - unorm8x4: 0..255 read as 0.0..1.0, for colors
+//  - unorm16x2/unorm16x4: 0..65535 read as 0.0..1.0
+//  - snorm10x3: xyz in 10 bits each (GL_INT_2_10_10_10_REV), for normals
+//
+// The pack* functions below fill them in from floats.
+namespace vertex
+{
+    struct vec2 { float x, y; };
+    struct vec3 { float x, y, z; };
+    struct vec4 { float x, y, z, w; };
+    struct half2 { std::uint16_t x, y; };
+    struct half4 { std::uint16_t x, y, z, w; };
+    struct unorm8x4 { std::uint8_t x, y, z, w; };
+    struct unorm16x2 { std::uint16_t x, y; };
+    struct unorm16x4 { std::uint16_t x, y, z, w; };
+    struct snorm10x3 { std::uint32_t bits; };
+    struct ivec2 { std::int32_t x, y; };
+    struct uvec4 { std::uint32_t x, y, z, w; };
+
+    // Round to nearest, clamped to the target's range
+    std::uint16_t packHalf(float value);
+    half2 packHalf2(float x, float y);
+    unorm8x4 packUnorm8x4(float x, float y, float z, float w = 1.0f);
+    unorm16x2 packUnorm16x2(float x, float y);
+    snorm10x3 packSnorm10x3(float x, float y, float z);
+
+    float unpackHalf(std::uint16_t bits);
+}
+
+// How GL reads an attribute type: glVertexAttribPointer's size, type and
+// normalized arguments, or glVertexAttribIPointer for integer ones
+template <GLint Components, GLenum Type, GLboolean Normalized = GL_FALSE, bool Integer = false>
+struct VertexFormatTraits
+{
+    static constexpr GLint components = Components;
+    static constexpr GLenum type = Type;
+    static constexpr GLboolean normalized = Normalized;
+    static constexpr bool integer = Integer;
+};
+
+template <typename T> struct VertexFormat;
+template <> struct VertexFormat<vertex::vec2> : VertexFormatTraits<2, GL_FLOAT> {};
+template <> struct VertexFormat<vertex::vec3> : VertexFormatTraits<3, GL_FLOAT> {};
+template <> struct VertexFormat<vertex::vec4> : VertexFormatTraits<4, GL_FLOAT> {};
+template <> struct VertexFormat<vertex::half2> : VertexFormatTraits<2, GL_HALF_FLOAT> {};
+template <> struct VertexFormat<vertex::half4> : VertexFormatTraits<4, GL_HALF_FLOAT> {};
+template <> struct VertexFormat<vertex::unorm8x4> : VertexFormatTraits<4, GL_UNSIGNED_BYTE, GL_TRUE> {};
+template <> struct VertexFormat<vertex::unorm16x2> : VertexFormatTraits<2, GL_UNSIGNED_SHORT, GL_TRUE> {};
+template <> struct VertexFormat<vertex::unorm16x4> : VertexFormatTraits<4, GL_UNSIGNED_SHORT, GL_TRUE> {};
+template <> struct VertexFormat<vertex::snorm10x3> : VertexFormatTraits<4, GL_INT_2_10_10_10_REV, GL_TRUE> {};
+template <> struct VertexFormat<vertex::ivec2> : VertexFormatTraits<2, GL_INT, GL_FALSE, true> {};
+template <> struct VertexFormat<vertex::uvec4> : VertexFormatTraits<4, GL_UNSIGNED_INT, GL_FALSE, true> {};
+
+// Offsets of tightly packed attributes, given their sizes
+template <size_t N>
+struct VertexOffsets
+{
+    size_t values[N];
+
+    constexpr size_t operator[](size_t index) const { return values[index]; }
+};
+
+template <size_t N>
+constexpr VertexOffsets<N> packVertexOffsets(const size_t (&sizes)[N])
+{
+    VertexOffsets<N> offsets {};
+    size_t offset = 0;
+    for (size_t i = 0; i < N; i++)
+    {
+        offsets.values[i] = offset;
+        offset += sizes[i];
+    }
+    return offsets;
+}
+
+// An interleaved vertex: attribute types in location order, tightly packed.
+// Stride and offsets are worked out at compile time, and apply() makes the
+// glVertexAttrib*Pointer calls for all of them:
+//
+//     struct QuadVertex
+//     {
+//         vertex::vec3 position;
+//         vertex::unorm8x4 color;
+//         vertex::half2 texCoord;
+//     };
+//     typedef VertexLayout<vertex::vec3, vertex::unorm8x4, vertex::half2> QuadLayout;
+//     VERTEX_ATTRIBUTE(QuadLayout, QuadVertex, 0, position);
+//     VERTEX_ATTRIBUTE(QuadLayout, QuadVertex, 1, color);
+//     VERTEX_ATTRIBUTE(QuadLayout, QuadVertex, 2, texCoord);
+//
+//     GLuint vao = QuadLayout::createVertexArray(vbo, ebo);
+template <typename... Attrs>
+class VertexLayout
+{
+    static_assert(sizeof...(Attrs) > 0, "a vertex needs at least one attribute");
+
+    static constexpr size_t sizes[] = { sizeof(Attrs)... };
+
+    template <size_t... I>
+    static void applyAll(GLuint firstLocation, GLuint divisor, std::index_sequence<I...>)
+    {
+        (applyOne<Attrs>(firstLocation + I, offsets[I], divisor), ...);
+    }
+
+    template <typename T>
+    static void applyOne(GLuint location, size_t offset, GLuint divisor)
+    {
+        typedef VertexFormat<T> Format;
+        if (Format::integer)
+            glVertexAttribIPointer(location, Format::components, Format::type, stride, (void*) offset);
+        else
+            glVertexAttribPointer(location, Format::components, Format::type, Format::normalized, stride,
+                                  (void*) offset);
+        glEnableVertexAttribArray(location);
+        if (divisor != 0)
+            glVertexAttribDivisor(location, divisor);
+    }
+
+    public:
+        static_assert(((sizeof(Attrs) % 4 == 0) && ...), "attributes must keep the next one 4-byte aligned");
+
+        static constexpr GLuint count = sizeof...(Attrs);
+        static constexpr GLsizei stride = (GLsizei) (sizeof(Attrs) + ...);
+        static constexpr VertexOffsets<sizeof...(Attrs)> offsets = packVertexOffsets(sizes);
+
+        template <size_t Index>
+        using Attribute = std::tuple_element_t<Index, std::tuple<Attrs...>>;
+
+        // Points attributes firstLocation, firstLocation + 1, ... of the
+        // bound VAO at the buffer bound to GL_ARRAY_BUFFER. A non-zero
+        // divisor makes them per-instance.
+        static void apply(GLuint firstLocation = 0, GLuint divisor = 0)
+        {
+            applyAll(firstLocation, divisor, std::index_sequence_for<Attrs...>());
+        }
+
+        // A new VAO reading vertices from vbo, and indices from ebo if one
+        // is given. Leaves the VAO bound.
+        static GLuint createVertexArray(GLuint vbo, GLuint ebo = 0)
+        {
+            GLuint vao;
+            glGenVertexArrays(1, &vao);
+            GLState::bindVertexArray(vao);
+            GLState::bindBuffer(GL_ARRAY_BUFFER, vbo);
+            if (ebo != 0)
+                GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+            apply();
+            return vao;
+        }
+};
+
+// Ties a struct member to an attribute of a layout, next to the struct:
+// it must have the attribute's type and sit at its offset, and the struct
+// must be exactly one vertex long. See VertexLayout.
+#define VERTEX_ATTRIBUTE(Layout, Vertex, index, member) \
+    static_assert(std::is_same<decltype(Vertex::member), Layout::Attribute<index>>::value, \
+                  #Vertex "::" #member " has a different type than attribute " #index); \
+    static_assert(offsetof(Vertex, member) == Layout::offsets[index], \
+                  #Vertex "::" #member " is not where attribute " #index " is"); \
+    static_assert(sizeof(Vertex) == Layout::stride, #Vertex " is not the size of one " #Layout " vertex")
+
+#endif // VERTEX_LAYOUT_H_